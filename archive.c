@@ -0,0 +1,450 @@
+/**
+ * @file archive.c
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Packed single-file animation archive.
+ *
+ * @details Writes and reads animation archives. Reading maps the whole
+ * archive into memory so any frame can be built without further file
+ * operations.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+#include "arena.h"
+#include "object.h"
+#include "vector.h"
+
+struct objarchive {
+	unsigned char *base;
+	size_t size;
+	const struct archive_header *hdr;
+	const struct archive_index *index;
+};
+
+/* --------------------------- Helper Functions -------------------------- */
+
+/* Check that a section of count elements fits inside the archive.
+ */
+static int in_bounds(const struct objarchive *ar, uint64_t off,
+	uint64_t count, size_t size)
+{
+	if(off > ar->size)
+		return 0;
+	if(count != 0 && (ar->size - off) / count < size)
+		return 0;
+	return 1;
+}
+/* Round an offset up to the archive section alignment.
+ */
+static uint64_t align_off(uint64_t off)
+{
+	return (off + ARCHIVE_ALIGN-1) & ~(uint64_t)(ARCHIVE_ALIGN-1);
+}
+/* Check that a section is aligned for its elements.
+ */
+static int is_aligned(uint64_t off, size_t align)
+{
+	return off % align == 0;
+}
+/* Compare the topology of two faces.
+ */
+static int face_equal(const struct face *a, const struct face *b)
+{
+	return a->num == b->num && a->mat == b->mat &&
+		a->face.f1 == b->face.f1 && a->face.f2 == b->face.f2 &&
+		a->face.f3 == b->face.f3 && a->tex.f1 == b->tex.f1 &&
+		a->tex.f2 == b->tex.f2 && a->tex.f3 == b->tex.f3;
+}
+/* Write count elements to file, returns 0 on success.
+ */
+static int write_data(FILE *fp, const void *data, size_t size, size_t count)
+{
+	if(count == 0)
+		return 0;
+	return fwrite(data, size, count, fp) != count;
+}
+/* Write zero bytes up to offset off, returns 0 on success.
+ */
+static int write_pad(FILE *fp, uint64_t off)
+{
+	long pos = ftell(fp);
+
+	if(pos < 0 || (uint64_t)pos > off)
+		return 1;
+	for(; (uint64_t)pos < off; pos++)
+		if(fputc(0, fp) == EOF)
+			return 1;
+	return 0;
+}
+/* Write shared topology of the first frame to file.
+ */
+static int write_shared(FILE *fp, const struct objfile *obj,
+	const struct archive_header *hdr)
+{
+	size_t i;
+
+	if(write_pad(fp, hdr->face_off))
+		return 1;
+	for(i = 0; i < obj->nf; i++) {
+		struct face f;
+		memset(&f, 0, sizeof(f));
+		f.num = obj->f[i].num;
+		f.mat = obj->f[i].mat;
+		f.face = obj->f[i].face;
+		f.tex = obj->f[i].tex;
+		if(write_data(fp, &f, sizeof(f), 1))
+			return 1;
+	}
+	if(write_pad(fp, hdr->tex_off) ||
+			write_data(fp, obj->t, sizeof(struct texcoord), obj->nt))
+		return 1;
+	if(write_pad(fp, hdr->mat_off))
+		return 1;
+	for(i = 0; i < obj->nmat; i++) {
+		struct material m = obj->mat[i];
+		m.texture = 0;
+		if(write_data(fp, &m, sizeof(m), 1))
+			return 1;
+	}
+	if(write_pad(fp, hdr->sub_off))
+		return 1;
+	return write_data(fp, obj->sub, sizeof(struct submesh), obj->nsub);
+}
+/* Check that a frame has the same topology as the first frame.
+ */
+static int same_topology(const struct objfile *a, const struct objfile *b)
+{
+	size_t i;
+
+	if(a->nv != b->nv || a->nvn != b->nvn || a->nt != b->nt ||
+			a->nf != b->nf || a->nmat != b->nmat || a->nsub != b->nsub)
+		return 0;
+	for(i = 0; i < a->nf; i++)
+		if(!face_equal(&a->f[i], &b->f[i]))
+			return 0;
+	for(i = 0; i < a->nsub; i++)
+		if(strcmp(a->sub[i].name, b->sub[i].name) != 0 ||
+				a->sub[i].first != b->sub[i].first ||
+				a->sub[i].count != b->sub[i].count)
+			return 0;
+	return 1;
+}
+
+/* -------------------------- Archive Functions -------------------------- */
+
+/* Open and map an archive, returns NULL if missing or invalid.
+ */
+struct objarchive *open_archive(const char *filename)
+{
+	const struct archive_header *hdr;
+	struct objarchive *ar;
+	struct stat st;
+	void *base;
+	uint32_t i;
+	int fd;
+
+	if((fd = open(filename, O_RDONLY)) < 0) {
+		if(errno != ENOENT)
+			fprintf(stderr, "Error: %s: %s\n", filename, strerror(errno));
+		return NULL;
+	}
+	if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*hdr)) {
+		fprintf(stderr, "Error: %s: Not an animation archive.\n", filename);
+		close(fd);
+		return NULL;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(base == MAP_FAILED) {
+		fprintf(stderr, "Error: %s: %s\n", filename, strerror(errno));
+		return NULL;
+	}
+	ar = (struct objarchive*)malloc(sizeof(struct objarchive));
+	if(!ar) {
+		fprintf(stderr, "Error: Cannot open archive, out of memory.\n");
+		munmap(base, st.st_size);
+		return NULL;
+	}
+	ar->base = base;
+	ar->size = st.st_size;
+	ar->hdr = hdr = (const struct archive_header*)base;
+	ar->index = (const struct archive_index*)(ar->base + hdr->index_off);
+	if(memcmp(hdr->magic, ARCHIVE_MAGIC, 4) != 0 ||
+			hdr->version != ARCHIVE_VERSION ||
+			!in_bounds(ar, hdr->index_off, hdr->frames,
+				sizeof(struct archive_index)) ||
+			!in_bounds(ar, hdr->face_off, hdr->nf,
+				sizeof(struct face)) ||
+			!in_bounds(ar, hdr->tex_off, hdr->nt,
+				sizeof(struct texcoord)) ||
+			!in_bounds(ar, hdr->mat_off, hdr->nmat,
+				sizeof(struct material)) ||
+			!in_bounds(ar, hdr->sub_off, hdr->nsub,
+				sizeof(struct submesh)) ||
+			!is_aligned(hdr->index_off, _Alignof(struct archive_index)) ||
+			!is_aligned(hdr->face_off, _Alignof(struct face)) ||
+			!is_aligned(hdr->tex_off, _Alignof(struct texcoord)) ||
+			!is_aligned(hdr->mat_off, _Alignof(struct material)) ||
+			!is_aligned(hdr->sub_off, _Alignof(struct submesh)))
+		goto invalid;
+	for(i = 0; i < hdr->nsub; i++) {
+		const struct submesh *sub = (const struct submesh*)
+			(ar->base + hdr->sub_off) + i;
+		if(sub->first > hdr->nf || sub->count > hdr->nf - sub->first)
+			goto invalid;
+	}
+	for(i = 0; i < hdr->frames; i++)
+		if(!in_bounds(ar, ar->index[i].v_off, hdr->nv,
+				sizeof(struct vec3)) ||
+				!in_bounds(ar, ar->index[i].vn_off, hdr->nvn,
+				sizeof(struct vec3)) ||
+				!is_aligned(ar->index[i].v_off, _Alignof(struct vec3)) ||
+				!is_aligned(ar->index[i].vn_off, _Alignof(struct vec3)))
+			goto invalid;
+	return ar;
+
+invalid:
+	fprintf(stderr, "Error: %s: Corrupt animation archive.\n", filename);
+	close_archive(ar);
+	return NULL;
+}
+/* Get number of frames stored in archive.
+ */
+int archive_frames(const struct objarchive *ar)
+{
+	return ar != NULL ? (int)ar->hdr->frames : 0;
+}
+/* Build an object for a frame without touching OpenGL.
+ */
+struct objfile *parse_archive_frame(struct objarchive *ar, int frame)
+{
+	const struct archive_header *hdr = ar->hdr;
+	const struct material *mat;
+	const struct submesh *sub;
+	const struct texcoord *t;
+	const struct vec3 *v, *vn;
+	const struct face *f;
+	struct objfile *obj;
+	uint32_t i;
+
+	if(frame < 0 || (uint32_t)frame >= hdr->frames)
+		return NULL;
+	if((obj = init_object()) == NULL)
+		return NULL;
+	f = (const struct face*)(ar->base + hdr->face_off);
+	t = (const struct texcoord*)(ar->base + hdr->tex_off);
+	mat = (const struct material*)(ar->base + hdr->mat_off);
+	sub = (const struct submesh*)(ar->base + hdr->sub_off);
+	v = (const struct vec3*)(ar->base + ar->index[frame].v_off);
+	vn = (const struct vec3*)(ar->base + ar->index[frame].vn_off);
+	for(i = 0; i < hdr->nv; i++)
+		vector_push_back(obj->v, v[i]);
+	for(i = 0; i < hdr->nvn; i++)
+		vector_push_back(obj->vn, vn[i]);
+	for(i = 0; i < hdr->nt; i++)
+		vector_push_back(obj->t, t[i]);
+	for(i = 0; i < hdr->nf; i++)
+		vector_push_back(obj->f, f[i]);
+	for(i = 0; i < hdr->nmat; i++)
+		vector_push_back(obj->mat, mat[i]);
+	for(i = 0; i < hdr->nsub; i++)
+		vector_push_back(obj->sub, sub[i]);
+	obj->nv = hdr->nv;
+	obj->nvn = hdr->nvn;
+	obj->nt = hdr->nt;
+	obj->nf = hdr->nf;
+	obj->nmat = hdr->nmat;
+	obj->nsub = hdr->nsub;
+	obj->isnorm = hdr->nvn > 0;
+	obj->istex = hdr->nt > 0;
+	obj->ismat = hdr->nmat > 0;
+	return obj;
+}
+/* Get number of arena bytes needed to hold one frame.
+ */
+size_t archive_frame_size(const struct objarchive *ar)
+{
+	const struct archive_header *hdr = ar->hdr;
+
+	return arena_round(sizeof(struct objfile)) +
+		arena_round(hdr->nv*sizeof(struct vec3)) +
+		arena_round(hdr->nvn*sizeof(struct vec3)) +
+		arena_round(hdr->nt*sizeof(struct texcoord)) +
+		arena_round(hdr->nf*sizeof(struct face)) +
+		arena_round(hdr->nmat*sizeof(struct material)) +
+		arena_round(hdr->nsub*sizeof(struct submesh));
+}
+/* Build an object for a frame inside an arena without touching OpenGL.
+ */
+struct objfile *parse_archive_frame_arena(struct objarchive *ar, int frame,
+	struct objarena *a)
+{
+	const struct archive_header *hdr = ar->hdr;
+	struct objfile *obj;
+
+	if(frame < 0 || (uint32_t)frame >= hdr->frames ||
+			a->size - a->used < archive_frame_size(ar))
+		return NULL;
+	obj = (struct objfile*)arena_alloc(a, sizeof(struct objfile));
+	memset(obj, 0, sizeof(struct objfile));
+	obj->v = arena_copy(a, ar->base + ar->index[frame].v_off,
+		hdr->nv*sizeof(struct vec3));
+	obj->vn = arena_copy(a, ar->base + ar->index[frame].vn_off,
+		hdr->nvn*sizeof(struct vec3));
+	obj->t = arena_copy(a, ar->base + hdr->tex_off,
+		hdr->nt*sizeof(struct texcoord));
+	obj->f = arena_copy(a, ar->base + hdr->face_off,
+		hdr->nf*sizeof(struct face));
+	obj->mat = arena_copy(a, ar->base + hdr->mat_off,
+		hdr->nmat*sizeof(struct material));
+	obj->sub = arena_copy(a, ar->base + hdr->sub_off,
+		hdr->nsub*sizeof(struct submesh));
+	obj->nv = hdr->nv;
+	obj->nvn = hdr->nvn;
+	obj->nt = hdr->nt;
+	obj->nf = hdr->nf;
+	obj->nmat = hdr->nmat;
+	obj->nsub = hdr->nsub;
+	obj->isnorm = hdr->nvn > 0;
+	obj->istex = hdr->nt > 0;
+	obj->ismat = hdr->nmat > 0;
+	obj->l = obj->ml = obj->sl = -1;
+	obj->refs = 1;
+	obj->arena = a;
+	return obj;
+}
+/* Build an object for a frame and upload it to OpenGL.
+ */
+struct objfile *load_archive_frame(struct objarchive *ar, int frame)
+{
+	struct objfile *obj;
+
+	if((obj = parse_archive_frame(ar, frame)) != NULL)
+		upload_object(obj);
+	return obj;
+}
+/* Unmap and free archive.
+ */
+void close_archive(struct objarchive *ar)
+{
+	if(ar == NULL)
+		return;
+	munmap(ar->base, ar->size);
+	free(ar);
+}
+/* Pack all frames of an animation into an archive file.
+ */
+int pack_anim(const char *dir, const char *anim_name, const char *filename)
+{
+	struct archive_header hdr;
+	struct objfile *first;
+	uint64_t frame_size, data_off;
+	char **names;
+	size_t i;
+	FILE *fp;
+
+	if((names = get_anim_names(dir, anim_name, SORTASC)) == NULL) {
+		fprintf(stderr, "Error: No frames found for %s.\n", anim_name);
+		return 1;
+	}
+	if((first = init_object()) == NULL || parse_object(first, names[0])) {
+		fprintf(stderr, "Error: Cannot load frame: %s\n", names[0]);
+		if(first != NULL)
+			destroy_object(first);
+		free_anim_names(names);
+		return 1;
+	}
+	if((fp = fopen(filename, "wb")) == NULL) {
+		fprintf(stderr, "Error: %s: %s\n", filename, strerror(errno));
+		destroy_object(first);
+		free_anim_names(names);
+		return 1;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, ARCHIVE_MAGIC, 4);
+	hdr.version = ARCHIVE_VERSION;
+	hdr.frames = vector_size(names);
+	hdr.nv = first->nv;
+	hdr.nvn = first->nvn;
+	hdr.nt = first->nt;
+	hdr.nf = first->nf;
+	hdr.nmat = first->nmat;
+	hdr.nsub = first->nsub;
+	hdr.index_off = align_off(sizeof(hdr));
+	hdr.face_off = align_off(hdr.index_off +
+		(uint64_t)hdr.frames*sizeof(struct archive_index));
+	hdr.tex_off = align_off(hdr.face_off +
+		(uint64_t)hdr.nf*sizeof(struct face));
+	hdr.mat_off = align_off(hdr.tex_off +
+		(uint64_t)hdr.nt*sizeof(struct texcoord));
+	hdr.sub_off = align_off(hdr.mat_off +
+		(uint64_t)hdr.nmat*sizeof(struct material));
+	data_off = align_off(hdr.sub_off +
+		(uint64_t)hdr.nsub*sizeof(struct submesh));
+	frame_size = (uint64_t)(hdr.nv+hdr.nvn)*sizeof(struct vec3);
+	if(write_data(fp, &hdr, sizeof(hdr), 1) || write_pad(fp, hdr.index_off))
+		goto fail;
+	for(i = 0; i < hdr.frames; i++) {
+		struct archive_index index;
+		index.v_off = data_off + i*frame_size;
+		index.vn_off = index.v_off + (uint64_t)hdr.nv*sizeof(struct vec3);
+		if(write_data(fp, &index, sizeof(index), 1))
+			goto fail;
+	}
+	if(write_shared(fp, first, &hdr) || write_pad(fp, data_off))
+		goto fail;
+
+	for(i = 0; i < hdr.frames; i++) {
+		struct objfile *frame = first;
+		if(i > 0) {
+			if((frame = init_object()) == NULL)
+				goto fail;
+			if(parse_object(frame, names[i]) ||
+					!same_topology(first, frame)) {
+				fprintf(stderr, "Error: Frame does not match "
+					"first frame: %s\n", names[i]);
+				destroy_object(frame);
+				goto fail;
+			}
+		}
+		if(write_data(fp, frame->v, sizeof(struct vec3), hdr.nv) ||
+				write_data(fp, frame->vn, sizeof(struct vec3),
+				hdr.nvn)) {
+			if(frame != first)
+				destroy_object(frame);
+			goto fail;
+		}
+		if(frame != first)
+			destroy_object(frame);
+		printf("Packed [DONE]: %lu - %s\n", i, names[i]);
+	}
+	destroy_object(first);
+	free_anim_names(names);
+	if(fclose(fp) != 0) {
+		fprintf(stderr, "Error: %s: %s\n", filename, strerror(errno));
+		remove(filename);
+		return 1;
+	}
+	return 0;
+
+fail:
+	fprintf(stderr, "Error: Cannot write archive: %s\n", filename);
+	destroy_object(first);
+	free_anim_names(names);
+	fclose(fp);
+	remove(filename);
+	return 1;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file archive.h
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Packed single-file animation archive.
+ *
+ * @details An archive holds every frame of an animation in one file
+ * that is mapped into memory when opened. Frames must share their
+ * faces, texture coordinates, materials and submeshes, only the vertex
+ * positions and normals are stored per frame.
+ *
+ * Layout (native byte order and struct layout, each shared section
+ * starts at a multiple of ARCHIVE_ALIGN bytes):
+ *   struct archive_header
+ *   struct archive_index[frames]
+ *   struct face[nf]               shared topology, triangles only
+ *   struct texcoord[nt]           shared texture coordinates
+ *   struct material[nmat]         shared materials (texture ids zero)
+ *   struct submesh[nsub]          shared submesh ranges, sorted by name
+ *   per frame: struct vec3[nv] positions, struct vec3[nvn] normals
+ */
+
+#ifndef PRS_ARCHIVE_H
+#define PRS_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "export.h"
+#include "object.h"
+
+#define ARCHIVE_MAGIC "OBJA"
+#define ARCHIVE_VERSION 4
+#define ARCHIVE_ALIGN 8
+#define ARCHIVE_EXT ".oba"
+
+struct archive_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t frames;
+	uint32_t nv, nvn, nt, nf, nmat, nsub;
+	uint64_t index_off, face_off;
+	uint64_t tex_off, mat_off;
+	uint64_t sub_off;
+};
+
+struct archive_index {
+	uint64_t v_off;
+	uint64_t vn_off;
+};
+
+struct objarchive;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+PRS_EXPORT struct objarchive *open_archive(const char *filename);
+PRS_EXPORT int archive_frames(const struct objarchive *ar);
+PRS_EXPORT struct objfile *parse_archive_frame(struct objarchive *ar, int frame);
+PRS_EXPORT struct objfile *load_archive_frame(struct objarchive *ar, int frame);
+PRS_EXPORT size_t archive_frame_size(const struct objarchive *ar);
+PRS_EXPORT struct objfile *parse_archive_frame_arena(struct objarchive *ar,
+	int frame, struct objarena *a);
+PRS_EXPORT void close_archive(struct objarchive *ar);
+PRS_EXPORT int pack_anim(const char *dir, const char *anim_name,
+	const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
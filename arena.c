@@ -0,0 +1,298 @@
+/**
+ * @file arena.c
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Arena backed object allocation.
+ *
+ * @details Objects are parsed as usual and then compacted into an
+ * arena sized exactly for them. Archive frames are copied straight
+ * from the mapped file into the arena.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "archive.h"
+#include "object.h"
+#include "vector.h"
+
+/* --------------------------- Arena Functions --------------------------- */
+
+/* Create an arena able to hold size bytes, in a single allocation.
+ */
+struct objarena *init_arena(size_t size)
+{
+	struct objarena *a;
+
+	size = arena_round(size);
+	a = (struct objarena*)malloc(arena_round(sizeof(struct objarena))+size);
+	if(!a) {
+		fprintf(stderr, "Error: Cannot create arena, out of memory.\n");
+		return NULL;
+	}
+	a->owner = NULL;
+	a->size = size;
+	a->used = 0;
+	a->data = (unsigned char*)a + arena_round(sizeof(struct objarena));
+	return a;
+}
+/* Bump allocate from arena, returns NULL when full.
+ */
+void *arena_alloc(struct objarena *a, size_t size)
+{
+	void *p;
+
+	size = arena_round(size);
+	if(size > a->size - a->used)
+		return NULL;
+	p = a->data + a->used;
+	a->used += size;
+	return p;
+}
+/* Copy data into arena, returns NULL for empty data.
+ */
+void *arena_copy(struct objarena *a, const void *src, size_t size)
+{
+	void *p;
+
+	if(size == 0)
+		return NULL;
+	if((p = arena_alloc(a, size)) != NULL)
+		memcpy(p, src, size);
+	return p;
+}
+/* Forget everything allocated from arena, keeping its memory.
+ */
+void reset_arena(struct objarena *a)
+{
+	a->owner = NULL;
+	a->used = 0;
+}
+/* Free arena and everything in it.
+ */
+void destroy_arena(struct objarena *a)
+{
+	free(a);
+}
+
+/* --------------------------- Object Functions -------------------------- */
+
+/* Get number of arena bytes needed to hold object.
+ */
+size_t object_size(const struct objfile *obj)
+{
+	size_t i, size;
+
+	size = arena_round(sizeof(struct objfile)) +
+		arena_round(obj->nv*sizeof(struct vec3)) +
+		arena_round(obj->nvn*sizeof(struct vec3)) +
+		arena_round(obj->nf*sizeof(struct face)) +
+		arena_round(obj->nmat*sizeof(struct material)) +
+		arena_round(obj->nt*sizeof(struct texcoord)) +
+		arena_round(obj->nsub*sizeof(struct submesh)) +
+		arena_round(obj->nlib*sizeof(char*));
+	for(i = 0; i < obj->nlib; i++)
+		size += arena_round(strlen(obj->lib[i])+1);
+	return size;
+}
+/* Move a parsed object into arena, the old object is freed.
+ * GL lists and textures move with it. Returns NULL if it does not fit.
+ */
+struct objfile *compact_object(struct objfile *obj, struct objarena *a)
+{
+	struct objfile *dst;
+	size_t i;
+
+	if(obj->arena != NULL || a->size - a->used < object_size(obj))
+		return NULL;
+	dst = (struct objfile*)arena_alloc(a, sizeof(struct objfile));
+	*dst = *obj;
+	dst->v = arena_copy(a, obj->v, obj->nv*sizeof(struct vec3));
+	dst->vn = arena_copy(a, obj->vn, obj->nvn*sizeof(struct vec3));
+	dst->f = arena_copy(a, obj->f, obj->nf*sizeof(struct face));
+	dst->mat = arena_copy(a, obj->mat, obj->nmat*sizeof(struct material));
+	dst->t = arena_copy(a, obj->t, obj->nt*sizeof(struct texcoord));
+	dst->sub = arena_copy(a, obj->sub, obj->nsub*sizeof(struct submesh));
+	dst->lib = arena_copy(a, obj->lib, obj->nlib*sizeof(char*));
+	for(i = 0; i < obj->nlib; i++) {
+		dst->lib[i] = arena_copy(a, obj->lib[i], strlen(obj->lib[i])+1);
+		free(obj->lib[i]);
+	}
+	dst->arena = a;
+
+	vector_free(obj->lib);
+	vector_free(obj->v);
+	vector_free(obj->vn);
+	vector_free(obj->f);
+	vector_free(obj->mat);
+	vector_free(obj->t);
+	vector_free(obj->sub);
+	memset(obj, 0, sizeof(struct objfile));
+	free(obj);
+	return dst;
+}
+/* Load an object into its own arena.
+ */
+struct objfile *load_object_arena(const char *filename)
+{
+	struct objfile *obj, *dst;
+	struct objarena *a;
+
+	if((obj = init_object()) == NULL)
+		return NULL;
+	if(parse_object(obj, filename) != 0 ||
+			(a = init_arena(object_size(obj))) == NULL) {
+		destroy_object(obj);
+		return NULL;
+	}
+	dst = compact_object(obj, a);
+	a->owner = dst;
+	upload_object(dst);
+	return dst;
+}
+/* Load every frame of an animation into one shared arena.
+ */
+struct objfile **load_anim_arena(const char *dir, const char *anim_name,
+	int mode)
+{
+	struct objfile **anim = NULL, **frames = NULL;
+	struct objarchive *ar;
+	struct objarena *a;
+	char **names, path[512];
+	size_t i, size;
+
+	printf("Loading animation: %s\n", anim_name);
+	snprintf(path, sizeof(path), "%s/%s%s", (dir != NULL ? dir : "."),
+		anim_name, ARCHIVE_EXT);
+	if((ar = open_archive(path)) != NULL) {
+		int n = archive_frames(ar);
+		if((a = init_arena(n*archive_frame_size(ar))) == NULL) {
+			close_archive(ar);
+			return NULL;
+		}
+		for(i = 0; i < (size_t)n; i++) {
+			int index = (mode == SORTDEC ? n-(int)i-1 : (int)i);
+			struct objfile *frame = parse_archive_frame_arena(ar, index, a);
+			if(frame == NULL)
+				continue;
+			upload_object(frame);
+			vector_push_back(anim, frame);
+		}
+		close_archive(ar);
+		if(anim == NULL)
+			destroy_arena(a);
+		return anim;
+	}
+
+	if((names = get_anim_names(dir, anim_name, mode)) == NULL)
+		return NULL;
+	size = 0;
+	for(i = 0; i < vector_size(names); i++) {
+		struct objfile *frame = init_object();
+		if(frame == NULL)
+			continue;
+		if(parse_object(frame, names[i]) != 0) {
+			fprintf(stderr, "Frame [FAIL]: %lu - %s\n", i, names[i]);
+			destroy_object(frame);
+			continue;
+		}
+		size += object_size(frame);
+		vector_push_back(frames, frame);
+	}
+	free_anim_names(names);
+	if(frames == NULL)
+		return NULL;
+	if((a = init_arena(size)) == NULL) {
+		for(i = 0; i < vector_size(frames); i++)
+			destroy_object(frames[i]);
+		vector_free(frames);
+		return NULL;
+	}
+	for(i = 0; i < vector_size(frames); i++) {
+		struct objfile *frame = compact_object(frames[i], a);
+		upload_object(frame);
+		vector_push_back(anim, frame);
+	}
+	vector_free(frames);
+	return anim;
+}
+
+/* ---------------------------- Pool Functions --------------------------- */
+
+/* Create an empty pool of reusable frames.
+ */
+struct objpool *init_pool(void)
+{
+	struct objpool *p;
+
+	p = (struct objpool*)malloc(sizeof(struct objpool));
+	if(!p) {
+		fprintf(stderr, "Error: Cannot create pool, out of memory.\n");
+		return NULL;
+	}
+	p->free = NULL;
+	p->count = p->cap = 0;
+	return p;
+}
+/* Load an archive frame reusing a released frame's arena when it fits.
+ */
+struct objfile *pool_frame(struct objpool *p, struct objarchive *ar, int frame)
+{
+	size_t i, size = archive_frame_size(ar);
+	struct objarena *a = NULL;
+	struct objfile *obj;
+
+	for(i = 0; i < p->count; i++) {
+		if(p->free[i]->arena->size >= size) {
+			a = p->free[i]->arena;
+			p->free[i] = p->free[--p->count];
+			break;
+		}
+	}
+	if(a == NULL && (a = init_arena(size)) == NULL)
+		return NULL;
+	reset_arena(a);
+	if((obj = parse_archive_frame_arena(ar, frame, a)) == NULL) {
+		destroy_arena(a);
+		return NULL;
+	}
+	a->owner = obj;
+	upload_object(obj);
+	return obj;
+}
+/* Give a frame back to the pool, its GL data is released.
+ */
+void release_frame(struct objpool *p, struct objfile *obj)
+{
+	if(obj->arena == NULL || obj->arena->owner != obj) {
+		destroy_object(obj);
+		return;
+	}
+	unload_object(obj);
+	if(p->count == p->cap) {
+		size_t cap = (p->cap ? p->cap*2 : 8);
+		struct objfile **tmp = realloc(p->free, cap*sizeof(struct objfile*));
+		if(tmp == NULL) {
+			destroy_object(obj);
+			return;
+		}
+		p->free = tmp;
+		p->cap = cap;
+	}
+	p->free[p->count++] = obj;
+}
+/* Free pool and every frame released to it.
+ */
+void destroy_pool(struct objpool *p)
+{
+	size_t i;
+
+	if(p == NULL)
+		return;
+	for(i = 0; i < p->count; i++)
+		destroy_arena(p->free[i]->arena);
+	free(p->free);
+	free(p);
+}
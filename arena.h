@@ -0,0 +1,62 @@
+/**
+ * @file arena.h
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Arena backed object allocation.
+ *
+ * @details An arena is one block sized from a parse that holds the
+ * object header and all of its arrays, so destroying it is a single
+ * free. One arena can also hold every frame of an animation. Objects
+ * in an arena cannot grow and cannot be hot reloaded.
+ */
+
+#ifndef PRS_ARENA_H
+#define PRS_ARENA_H
+
+#include <stddef.h>
+
+#include "export.h"
+#include "object.h"
+#include "archive.h"
+
+#define ARENA_ALIGN 16
+#define arena_round(n) (((n) + ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1))
+
+struct objarena {
+	struct objfile *owner;
+	size_t size, used;
+	unsigned char *data;
+};
+
+struct objpool {
+	struct objfile **free;
+	size_t count, cap;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+PRS_EXPORT struct objarena *init_arena(size_t size);
+PRS_EXPORT void *arena_alloc(struct objarena *a, size_t size);
+PRS_EXPORT void *arena_copy(struct objarena *a, const void *src,
+	size_t size);
+PRS_EXPORT void reset_arena(struct objarena *a);
+PRS_EXPORT void destroy_arena(struct objarena *a);
+PRS_EXPORT size_t object_size(const struct objfile *obj);
+PRS_EXPORT struct objfile *compact_object(struct objfile *obj,
+	struct objarena *a);
+PRS_EXPORT struct objfile *load_object_arena(const char *filename);
+PRS_EXPORT struct objfile **load_anim_arena(const char *dir,
+	const char *anim_name, int mode);
+PRS_EXPORT struct objpool *init_pool(void);
+PRS_EXPORT struct objfile *pool_frame(struct objpool *p,
+	struct objarchive *ar, int frame);
+PRS_EXPORT void release_frame(struct objpool *p, struct objfile *obj);
+PRS_EXPORT void destroy_pool(struct objpool *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
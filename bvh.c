@@ -0,0 +1,546 @@
+/**
+ * @file bvh.c
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Bounding volume hierarchy for picking and spatial queries.
+ *
+ * @details Triangles store their first corner and two edges so ray
+ * tests need no index lookups. Barycentrics u and v weight the second
+ * and third corner of the hit triangle.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "bvh.h"
+#include "object.h"
+
+#define BVH_STACK 64
+#define BVH_DEPTH (BVH_STACK-4)
+
+struct build {
+	struct bvh_tri *tris;
+	struct bvh_node *nodes;
+	float (*bmin)[3], (*bmax)[3], (*cent)[3];
+	int *idx;
+	int nnodes;
+};
+
+struct bin {
+	float min[3], max[3];
+	int count;
+};
+
+/* --------------------------- Helper Functions -------------------------- */
+
+/* Subtract two vectors.
+ */
+static struct vec3 vsub(struct vec3 a, struct vec3 b)
+{
+	struct vec3 r = {a.x-b.x, a.y-b.y, a.z-b.z};
+	return r;
+}
+/* Add scaled vector b to a.
+ */
+static struct vec3 vmad(struct vec3 a, struct vec3 b, float s)
+{
+	struct vec3 r = {a.x+b.x*s, a.y+b.y*s, a.z+b.z*s};
+	return r;
+}
+/* Cross product of two vectors.
+ */
+static struct vec3 vcross(struct vec3 a, struct vec3 b)
+{
+	struct vec3 r = {a.y*b.z-a.z*b.y, a.z*b.x-a.x*b.z, a.x*b.y-a.y*b.x};
+	return r;
+}
+/* Dot product of two vectors.
+ */
+static float vdot(struct vec3 a, struct vec3 b)
+{
+	return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+/* Reset bounds to empty.
+ */
+static void empty_bounds(float *min, float *max)
+{
+	min[0] = min[1] = min[2] = FLT_MAX;
+	max[0] = max[1] = max[2] = -FLT_MAX;
+}
+/* Grow bounds by other bounds.
+ */
+static void grow_bounds(float *min, float *max, const float *omin,
+	const float *omax)
+{
+	int k;
+
+	for(k = 0; k < 3; k++) {
+		if(omin[k] < min[k]) min[k] = omin[k];
+		if(omax[k] > max[k]) max[k] = omax[k];
+	}
+}
+/* Half surface area of bounds.
+ */
+static float half_area(const float *min, const float *max)
+{
+	float dx = max[0]-min[0], dy = max[1]-min[1], dz = max[2]-min[2];
+
+	if(dx < 0.0f)
+		return 0.0f;
+	return dx*dy + dy*dz + dz*dx;
+}
+/* Check vertex index is inside object.
+ */
+static int valid_index(const struct objfile *obj, int i)
+{
+	return i >= 1 && (size_t)i <= obj->nv;
+}
+/* Add triangle of vertex indexes to builder.
+ */
+static void add_tri(struct build *b, int n, const struct objfile *obj,
+	int i0, int i1, int i2, int face)
+{
+	struct vec3 p[3];
+	int j, k;
+
+	p[0] = obj->v[i0-1];
+	p[1] = obj->v[i1-1];
+	p[2] = obj->v[i2-1];
+	b->tris[n].a = p[0];
+	b->tris[n].e1 = vsub(p[1], p[0]);
+	b->tris[n].e2 = vsub(p[2], p[0]);
+	b->tris[n].face = face;
+	empty_bounds(b->bmin[n], b->bmax[n]);
+	for(j = 0; j < 3; j++) {
+		const float c[3] = {p[j].x, p[j].y, p[j].z};
+		grow_bounds(b->bmin[n], b->bmax[n], c, c);
+	}
+	for(k = 0; k < 3; k++)
+		b->cent[n][k] = (b->bmin[n][k] + b->bmax[n][k]) * 0.5f;
+}
+/* Recursively build nodes for idx[start..start+count), returns node.
+ */
+static int build_node(struct build *b, int start, int count, int depth)
+{
+	struct bin bins[3][BVH_BINS];
+	float cmin[3], cmax[3], best_cost;
+	int node = b->nnodes++;
+	int i, k, axis, split, mid;
+	struct bvh_node *n;
+
+	n = &b->nodes[node];
+	empty_bounds(n->min, n->max);
+	empty_bounds(cmin, cmax);
+	for(i = start; i < start+count; i++) {
+		grow_bounds(n->min, n->max, b->bmin[b->idx[i]], b->bmax[b->idx[i]]);
+		grow_bounds(cmin, cmax, b->cent[b->idx[i]], b->cent[b->idx[i]]);
+	}
+	n->offset = start;
+	n->count = count;
+	if(count <= 1 || depth >= BVH_DEPTH)
+		return node;
+
+	/* Bin centroids along each axis and find cheapest split. */
+	best_cost = FLT_MAX;
+	axis = split = -1;
+	for(k = 0; k < 3; k++) {
+		float lmin[3], lmax[3], area_left[BVH_BINS];
+		float extent = cmax[k] - cmin[k];
+		int count_left[BVH_BINS], total;
+
+		if(extent <= 0.0f)
+			continue;
+		for(i = 0; i < BVH_BINS; i++) {
+			empty_bounds(bins[k][i].min, bins[k][i].max);
+			bins[k][i].count = 0;
+		}
+		for(i = start; i < start+count; i++) {
+			int t = b->idx[i];
+			int j = (int)((b->cent[t][k]-cmin[k]) / extent * BVH_BINS);
+			if(j >= BVH_BINS) j = BVH_BINS-1;
+			bins[k][j].count++;
+			grow_bounds(bins[k][j].min, bins[k][j].max,
+				b->bmin[t], b->bmax[t]);
+		}
+		empty_bounds(lmin, lmax);
+		for(i = 0, total = 0; i < BVH_BINS-1; i++) {
+			grow_bounds(lmin, lmax, bins[k][i].min, bins[k][i].max);
+			total += bins[k][i].count;
+			area_left[i] = half_area(lmin, lmax);
+			count_left[i] = total;
+		}
+		empty_bounds(lmin, lmax);
+		for(i = BVH_BINS-1, total = 0; i > 0; i--) {
+			float cost;
+			grow_bounds(lmin, lmax, bins[k][i].min, bins[k][i].max);
+			total += bins[k][i].count;
+			if(count_left[i-1] == 0 || total == 0)
+				continue;
+			cost = area_left[i-1]*count_left[i-1] +
+				half_area(lmin, lmax)*total;
+			if(cost < best_cost) {
+				best_cost = cost;
+				axis = k;
+				split = i;
+			}
+		}
+	}
+
+	/* Leaf when splitting does not pay off. */
+	if(axis < 0 || (count <= BVH_LEAF &&
+			best_cost / half_area(n->min, n->max) + 1.0f >= count))
+		return node;
+
+	/* Partition triangles around the split bin. */
+	for(i = start, mid = start+count; i < mid; ) {
+		int t = b->idx[i];
+		int j = (int)((b->cent[t][axis]-cmin[axis]) /
+			(cmax[axis]-cmin[axis]) * BVH_BINS);
+		if(j >= BVH_BINS) j = BVH_BINS-1;
+		if(j < split) {
+			i++;
+		} else {
+			b->idx[i] = b->idx[--mid];
+			b->idx[mid] = t;
+		}
+	}
+	if(mid == start || mid == start+count)
+		mid = start + count/2;
+
+	b->nodes[node].count = 0;
+	build_node(b, start, mid-start, depth+1);
+	b->nodes[node].offset = build_node(b, mid, start+count-mid, depth+1);
+	return node;
+}
+/* Ray versus box slab test, returns entry distance or FLT_MAX on miss.
+ */
+static float ray_box(const struct bvh_node *n, const float *o,
+	const float *inv, float tmax)
+{
+	float t0 = 0.0f, t1 = tmax;
+	int k;
+
+	for(k = 0; k < 3; k++) {
+		float a = (n->min[k]-o[k])*inv[k];
+		float b = (n->max[k]-o[k])*inv[k];
+		if(a > b) { float tmp = a; a = b; b = tmp; }
+		if(a > t0) t0 = a;
+		if(b < t1) t1 = b;
+		if(t0 > t1)
+			return FLT_MAX;
+	}
+	return t0;
+}
+/* Squared distance from point to box.
+ */
+static float point_box(const struct bvh_node *n, const float *p)
+{
+	float d = 0.0f;
+	int k;
+
+	for(k = 0; k < 3; k++) {
+		float e = 0.0f;
+		if(p[k] < n->min[k]) e = n->min[k]-p[k];
+		else if(p[k] > n->max[k]) e = p[k]-n->max[k];
+		d += e*e;
+	}
+	return d;
+}
+/* Closest point on triangle, returns barycentrics of second and third
+ * corner in u and v.
+ */
+static struct vec3 closest_tri(const struct bvh_tri *t, struct vec3 p,
+	float *u, float *v)
+{
+	struct vec3 b = vmad(t->a, t->e1, 1.0f), c = vmad(t->a, t->e2, 1.0f);
+	struct vec3 ap = vsub(p, t->a), bp = vsub(p, b), cp = vsub(p, c);
+	float d1 = vdot(t->e1, ap), d2 = vdot(t->e2, ap);
+	float d3 = vdot(t->e1, bp), d4 = vdot(t->e2, bp);
+	float d5 = vdot(t->e1, cp), d6 = vdot(t->e2, cp);
+	float va, vb, vc, denom;
+
+	if(d1 <= 0.0f && d2 <= 0.0f) {
+		*u = *v = 0.0f;
+		return t->a;
+	}
+	if(d3 >= 0.0f && d4 <= d3) {
+		*u = 1.0f; *v = 0.0f;
+		return b;
+	}
+	vc = d1*d4 - d3*d2;
+	if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		*u = d1 / (d1-d3); *v = 0.0f;
+		return vmad(t->a, t->e1, *u);
+	}
+	if(d6 >= 0.0f && d5 <= d6) {
+		*u = 0.0f; *v = 1.0f;
+		return c;
+	}
+	vb = d5*d2 - d1*d6;
+	if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		*u = 0.0f; *v = d2 / (d2-d6);
+		return vmad(t->a, t->e2, *v);
+	}
+	va = d3*d6 - d5*d4;
+	if(va <= 0.0f && (d4-d3) >= 0.0f && (d5-d6) >= 0.0f) {
+		*v = (d4-d3) / ((d4-d3) + (d5-d6));
+		*u = 1.0f - *v;
+		return vmad(b, vsub(c, b), *v);
+	}
+	denom = 1.0f / (va+vb+vc);
+	*u = vb*denom;
+	*v = vc*denom;
+	return vmad(vmad(t->a, t->e1, *u), t->e2, *v);
+}
+
+/* ----------------------------- BVH Functions --------------------------- */
+
+/* Build BVH over every valid triangle of an object.
+ */
+struct objbvh *build_bvh(const struct objfile *obj)
+{
+	struct objbvh *bvh;
+	struct bvh_tri *sorted;
+	struct build b;
+	size_t i;
+	int n;
+
+	memset(&b, 0, sizeof(b));
+	b.tris = malloc(sizeof(struct bvh_tri)*(obj->nf+1));
+	b.bmin = malloc(sizeof(float[3])*(obj->nf+1));
+	b.bmax = malloc(sizeof(float[3])*(obj->nf+1));
+	b.cent = malloc(sizeof(float[3])*(obj->nf+1));
+	b.idx = malloc(sizeof(int)*(obj->nf+1));
+	bvh = (struct objbvh*)malloc(sizeof(struct objbvh));
+	if(!b.tris || !b.bmin || !b.bmax || !b.cent || !b.idx || !bvh)
+		goto fail;
+
+	for(i = 0, n = 0; i < obj->nf; i++) {
+		const struct face *f = &obj->f[i];
+		if(!valid_index(obj, f->face.f1) || !valid_index(obj, f->face.f2) ||
+				!valid_index(obj, f->face.f3))
+			continue;
+		add_tri(&b, n++, obj, f->face.f1, f->face.f2, f->face.f3, i);
+	}
+	for(i = 0; i < (size_t)n; i++)
+		b.idx[i] = i;
+	b.nodes = malloc(sizeof(struct bvh_node)*(n > 0 ? 2*n-1 : 1));
+	if(!b.nodes)
+		goto fail;
+	if(n > 0) {
+		build_node(&b, 0, n, 0);
+	} else {
+		empty_bounds(b.nodes[0].min, b.nodes[0].max);
+		b.nodes[0].offset = b.nodes[0].count = 0;
+		b.nnodes = 1;
+	}
+
+	/* Store triangles in leaf order. */
+	if((sorted = malloc(sizeof(struct bvh_tri)*(n+1))) == NULL)
+		goto fail;
+	for(i = 0; i < (size_t)n; i++)
+		sorted[i] = b.tris[b.idx[i]];
+	free(b.tris);
+	free(b.bmin);
+	free(b.bmax);
+	free(b.cent);
+	free(b.idx);
+	bvh->tris = sorted;
+	bvh->ntris = n;
+	bvh->nodes = b.nodes;
+	bvh->nnodes = b.nnodes;
+	return bvh;
+
+fail:
+	fprintf(stderr, "Error: Cannot build BVH, out of memory.\n");
+	free(b.tris);
+	free(b.bmin);
+	free(b.bmax);
+	free(b.cent);
+	free(b.idx);
+	free(b.nodes);
+	free(bvh);
+	return NULL;
+}
+/* Find nearest triangle hit by ray within tmax, returns 1 on hit.
+ */
+int bvh_intersect(const struct objbvh *bvh, struct vec3 orig, struct vec3 dir,
+	float tmax, struct bvh_hit *hit)
+{
+	const float o[3] = {orig.x, orig.y, orig.z};
+	const float inv[3] = {1.0f/dir.x, 1.0f/dir.y, 1.0f/dir.z};
+	int stack[BVH_STACK], sp = 0, found = 0;
+	float best = tmax;
+
+	if(bvh->ntris == 0 || ray_box(&bvh->nodes[0], o, inv, best) == FLT_MAX)
+		return 0;
+	stack[sp++] = 0;
+	while(sp > 0) {
+		const struct bvh_node *n = &bvh->nodes[stack[--sp]];
+		int i;
+
+		if(n->count == 0) {
+			int l = n - bvh->nodes + 1, r = n->offset;
+			float tl = ray_box(&bvh->nodes[l], o, inv, best);
+			float tr = ray_box(&bvh->nodes[r], o, inv, best);
+			if(tl > tr) {
+				int tmp = l; l = r; r = tmp;
+				float tf = tl; tl = tr; tr = tf;
+			}
+			if(tr != FLT_MAX && sp < BVH_STACK)
+				stack[sp++] = r;
+			if(tl != FLT_MAX && sp < BVH_STACK)
+				stack[sp++] = l;
+			continue;
+		}
+		for(i = n->offset; i < n->offset+n->count; i++) {
+			const struct bvh_tri *t = &bvh->tris[i];
+			struct vec3 p = vcross(dir, t->e2), s, q;
+			float det = vdot(t->e1, p), invdet, u, v, d;
+
+			if(fabsf(det) < 1e-12f)
+				continue;
+			invdet = 1.0f / det;
+			s = vsub(orig, t->a);
+			u = vdot(s, p) * invdet;
+			if(u < 0.0f || u > 1.0f)
+				continue;
+			q = vcross(s, t->e1);
+			v = vdot(dir, q) * invdet;
+			if(v < 0.0f || u+v > 1.0f)
+				continue;
+			d = vdot(t->e2, q) * invdet;
+			if(d <= 0.0f || d >= best)
+				continue;
+			best = d;
+			found = 1;
+			hit->face = t->face;
+			hit->t = d;
+			hit->u = u;
+			hit->v = v;
+		}
+	}
+	if(found)
+		hit->point = vmad(orig, dir, hit->t);
+	return found;
+}
+/* Find closest point on the mesh within maxdist, returns 1 if found.
+ * The distance is returned in hit->t.
+ */
+int bvh_closest(const struct objbvh *bvh, struct vec3 p, float maxdist,
+	struct bvh_hit *hit)
+{
+	const float pf[3] = {p.x, p.y, p.z};
+	int stack[BVH_STACK], sp = 0, found = 0;
+	float best = maxdist*maxdist;
+
+	if(bvh->ntris == 0 || point_box(&bvh->nodes[0], pf) > best)
+		return 0;
+	stack[sp++] = 0;
+	while(sp > 0) {
+		const struct bvh_node *n = &bvh->nodes[stack[--sp]];
+		int i;
+
+		if(point_box(n, pf) > best)
+			continue;
+		if(n->count == 0) {
+			int l = n - bvh->nodes + 1, r = n->offset;
+			float dl = point_box(&bvh->nodes[l], pf);
+			float dr = point_box(&bvh->nodes[r], pf);
+			if(dl > dr) {
+				int tmp = l; l = r; r = tmp;
+			}
+			if(sp+2 <= BVH_STACK) {
+				stack[sp++] = r;
+				stack[sp++] = l;
+			}
+			continue;
+		}
+		for(i = n->offset; i < n->offset+n->count; i++) {
+			struct vec3 c, d;
+			float u, v, dist;
+
+			c = closest_tri(&bvh->tris[i], p, &u, &v);
+			d = vsub(c, p);
+			dist = vdot(d, d);
+			if(dist > best)
+				continue;
+			best = dist;
+			found = 1;
+			hit->face = bvh->tris[i].face;
+			hit->u = u;
+			hit->v = v;
+			hit->point = c;
+		}
+	}
+	if(found)
+		hit->t = sqrtf(best);
+	return found;
+}
+/* Collect faces whose triangle bounds overlap a box.
+ * Returns number of overlapping faces, only max_faces are stored.
+ */
+int bvh_overlap(const struct objbvh *bvh, struct vec3 min, struct vec3 max,
+	int *faces, int max_faces)
+{
+	const float qmin[3] = {min.x, min.y, min.z};
+	const float qmax[3] = {max.x, max.y, max.z};
+	int stack[BVH_STACK], sp = 0, count = 0;
+
+	if(bvh->ntris == 0)
+		return 0;
+	stack[sp++] = 0;
+	while(sp > 0) {
+		const struct bvh_node *n = &bvh->nodes[stack[--sp]];
+		int i, k;
+
+		for(k = 0; k < 3; k++)
+			if(n->min[k] > qmax[k] || n->max[k] < qmin[k])
+				break;
+		if(k < 3)
+			continue;
+		if(n->count == 0) {
+			if(sp+2 <= BVH_STACK) {
+				stack[sp++] = n->offset;
+				stack[sp++] = n - bvh->nodes + 1;
+			}
+			continue;
+		}
+		for(i = n->offset; i < n->offset+n->count; i++) {
+			const struct bvh_tri *t = &bvh->tris[i];
+			const struct vec3 b = vmad(t->a, t->e1, 1.0f);
+			const struct vec3 c = vmad(t->a, t->e2, 1.0f);
+			const float tmin[3] = {
+				fminf(t->a.x, fminf(b.x, c.x)),
+				fminf(t->a.y, fminf(b.y, c.y)),
+				fminf(t->a.z, fminf(b.z, c.z))};
+			const float tmax[3] = {
+				fmaxf(t->a.x, fmaxf(b.x, c.x)),
+				fmaxf(t->a.y, fmaxf(b.y, c.y)),
+				fmaxf(t->a.z, fmaxf(b.z, c.z))};
+
+			for(k = 0; k < 3; k++)
+				if(tmin[k] > qmax[k] || tmax[k] < qmin[k])
+					break;
+			if(k < 3)
+				continue;
+			if(count < max_faces)
+				faces[count] = t->face;
+			count++;
+		}
+	}
+	return count;
+}
+/* Free BVH.
+ */
+void destroy_bvh(struct objbvh *bvh)
+{
+	if(bvh == NULL)
+		return;
+	free(bvh->nodes);
+	free(bvh->tris);
+	free(bvh);
+}
@@ -0,0 +1,63 @@
+/**
+ * @file bvh.h
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Bounding volume hierarchy for picking and spatial queries.
+ *
+ * @details Builds a binned SAH tree over the triangles of an object
+ * and stores it flattened in depth first order, the second child of a
+ * node always follows its first subtree. Queries report the face index
+ * into obj->f and the barycentric coordinates on that triangle.
+ */
+
+#ifndef PRS_BVH_H
+#define PRS_BVH_H
+
+#include "export.h"
+#include "object.h"
+
+#define BVH_BINS 16
+#define BVH_LEAF 4
+
+struct bvh_node {
+	float min[3];
+	int offset;     /* first triangle for leaves, second child otherwise */
+	float max[3];
+	int count;      /* triangles in leaf, zero for inner nodes */
+};
+
+struct bvh_tri {
+	struct vec3 a, e1, e2;
+	int face;
+};
+
+struct bvh_hit {
+	int face;
+	float t, u, v;
+	struct vec3 point;
+};
+
+struct objbvh {
+	struct bvh_node *nodes;
+	struct bvh_tri *tris;
+	int nnodes, ntris;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+PRS_EXPORT struct objbvh *build_bvh(const struct objfile *obj);
+PRS_EXPORT int bvh_intersect(const struct objbvh *bvh, struct vec3 orig,
+	struct vec3 dir, float tmax, struct bvh_hit *hit);
+PRS_EXPORT int bvh_closest(const struct objbvh *bvh, struct vec3 p,
+	float maxdist, struct bvh_hit *hit);
+PRS_EXPORT int bvh_overlap(const struct objbvh *bvh, struct vec3 min,
+	struct vec3 max, int *faces, int max_faces);
+PRS_EXPORT void destroy_bvh(struct objbvh *bvh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
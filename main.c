@@ -7,28 +7,72 @@
  *****************************************************************************
  */
 
+#define _POSIX_C_SOURCE 200809L
+#define GL_GLEXT_PROTOTYPES
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "unused.h"
 #include "object.h"
+#include "scene.h"
+#include "watch.h"
 #include "vector.h"
 
 #include "GL/freeglut.h"
 
 #define FPS 60 // For regulating FPS
+#define ANIM_MS 100 // Time between animation frames
 
 static struct objfile *obj, *obj2, *obj3, **anim1, **anim2;
+static struct objwatch *watch;
 static int anim_frame;
 
+/* Everything the test program shows, loaded in one batch. */
+static struct scene_entry scene[] = {
+	{SCENE_OBJECT, "test.obj", NULL, 0, NULL, NULL},
+	{SCENE_OBJECT, "test2.obj", NULL, 0, NULL, NULL},
+	{SCENE_OBJECT, "test3.obj", NULL, 0, NULL, NULL},
+	{SCENE_ANIM, "./anim", "cube_anim1", SORTASC, NULL, NULL},
+	{SCENE_ANIM, "./anim", "cube_anim1", SORTDEC, NULL, NULL}
+};
+
+/* Redraw only when something changed, paced to FPS. */
+static int dirty = 1;
+static double next_frame;
+static float yaw, pitch;
+
+/* Timing overlay, GPU time comes from timer queries when supported. */
+static int overlay = 1;
+static unsigned int queries[2];
+static int has_timer, frames;
+static double cpu_ms, gpu_ms;
+static long draw_calls, draw_faces;
+
+/* Get monotonic time in milliseconds.
+ */
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e3 + ts.tv_nsec*1e-6;
+}
+
 /* Clean up all memory resources.
  */
 void cleanup()
 {
-	destroy_object(obj);
-	destroy_object(obj2);
-	destroy_object(obj3);
+	if(has_timer)
+		glDeleteQueries(2, queries);
+	destroy_watch(watch);
+	if(obj != NULL)
+		destroy_object(obj);
+	if(obj2 != NULL)
+		destroy_object(obj2);
+	if(obj3 != NULL)
+		destroy_object(obj3);
 	destroy_anim(anim1);
 	destroy_anim(anim2);
 }
@@ -54,37 +98,115 @@ void change_size(int w, int h)
 	glEnable(GL_LIGHTING);
 	glEnable(GL_LIGHT0);
 	glLightfv(GL_LIGHT0, GL_DIFFUSE, col);
+	dirty = 1;
+}
+/* Draw object and count its draw calls in the frame statistics.
+ */
+static void draw_counted(struct objfile *o)
+{
+	draw_object(o);
+	draw_calls += o->draws;
+	draw_faces += o->nf;
+}
+/* Draw timing of the last frame in the top left corner.
+ */
+static void draw_overlay(void)
+{
+	int w = glutGet(GLUT_WINDOW_WIDTH), h = glutGet(GLUT_WINDOW_HEIGHT);
+	char line[128];
+
+	glPushAttrib(GL_ENABLE_BIT|GL_CURRENT_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	gluOrtho2D(0, w, 0, h);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glColor3f(1.0f, 1.0f, 1.0f);
+
+	glRasterPos2i(8, h-20);
+	snprintf(line, sizeof(line), "CPU: %.3f ms", cpu_ms);
+	glutBitmapString(GLUT_BITMAP_HELVETICA_12, (unsigned char*)line);
+	glRasterPos2i(8, h-36);
+	if(has_timer)
+		snprintf(line, sizeof(line), "GPU: %.3f ms", gpu_ms);
+	else
+		snprintf(line, sizeof(line), "GPU: n/a");
+	glutBitmapString(GLUT_BITMAP_HELVETICA_12, (unsigned char*)line);
+	glRasterPos2i(8, h-52);
+	snprintf(line, sizeof(line), "Draws: %ld, faces: %ld, frames: %d",
+		draw_calls, draw_faces, frames);
+	glutBitmapString(GLUT_BITMAP_HELVETICA_12, (unsigned char*)line);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopAttrib();
 }
 /* Render the scene.
  */
 void render_scene()
 {
+	double start = now_ms();
+
 	if(anim_frame >= (int)vector_size(anim1))
 		anim_frame = 0;
 
+	/* Result of the previous frame's query, without waiting on it. */
+	if(has_timer && frames > 0) {
+		GLuint64 ns;
+		GLint ready = 0;
+
+		glGetQueryObjectiv(queries[(frames-1)&1],
+			GL_QUERY_RESULT_AVAILABLE, &ready);
+		if(ready) {
+			glGetQueryObjectui64v(queries[(frames-1)&1],
+				GL_QUERY_RESULT, &ns);
+			gpu_ms = ns*1e-6;
+		}
+	}
+	if(has_timer)
+		glBeginQuery(GL_TIME_ELAPSED, queries[frames&1]);
+	draw_calls = draw_faces = 0;
+
 	glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
 
 	gluLookAt(0.0f, 0.0f, 10.0f,
 		0.0f, 0.0f, 0.0f,
 		0.0f, 1.0f, 0.0f);
+	glRotatef(pitch, 1.0f, 0.0f, 0.0f);
+	glRotatef(yaw, 0.0f, 1.0f, 0.0f);
 
 	/* draw object */
 	glTranslatef(-5.0f, 0.0f, -20.0f);
-	draw_object(obj);
+	draw_counted(obj);
 	glTranslatef(10.0f, 0.0f, 10.0f);
-	draw_object(obj2);
+	draw_counted(obj2);
 	glTranslatef(-5.0f, 0.0f, -20.0f);
-	draw_object(obj3);
+	draw_counted(obj3);
 
 	/* draw anim1 */
 	glTranslatef(-3.0f, 0.0f, 0.0f);
-	draw_anim(anim1, anim_frame);
+	if(anim_frame < (int)vector_size(anim1))
+		draw_counted(anim1[anim_frame]);
 
-	/* draw anim2 */
+	/* draw anim2, it may have lost frames that failed to load */
 	glTranslatef(3.0f, 0.0f, 0.0f);
-	draw_anim(anim2, anim_frame);
+	if(anim_frame < (int)vector_size(anim2))
+		draw_counted(anim2[anim_frame]);
 
+	if(has_timer)
+		glEndQuery(GL_TIME_ELAPSED);
+	cpu_ms = now_ms() - start;
+	if(overlay)
+		draw_overlay();
+	frames++;
 	glutSwapBuffers();
 }
 /* Timer function for animation.
@@ -92,8 +214,59 @@ void render_scene()
 void timer(int UNUSED(timer_id))
 {
 	anim_frame++;
-	glutTimerFunc(100, timer, 0);
-	glutPostRedisplay();
+	dirty = 1;
+	glutTimerFunc(ANIM_MS, timer, 0);
+}
+/* Frame pacing, redraws at most FPS times a second and only when
+ * something changed.
+ */
+void pace(int UNUSED(timer_id))
+{
+	double t = now_ms();
+
+	if(watch != NULL && poll_watch(watch) > 0)
+		dirty = 1;
+	if(dirty) {
+		dirty = 0;
+		glutPostRedisplay();
+	}
+
+	/* Fixed deadlines keep the rate, but never try to catch up. */
+	next_frame += 1000.0/FPS;
+	if(next_frame < t)
+		next_frame = t;
+	glutTimerFunc((unsigned int)(next_frame - t + 0.5), pace, 0);
+}
+/* Rotate view with arrow keys.
+ */
+void special_keys(int key, int UNUSED(x), int UNUSED(y))
+{
+	switch(key) {
+	case GLUT_KEY_LEFT:
+		yaw -= 5.0f;
+		break;
+	case GLUT_KEY_RIGHT:
+		yaw += 5.0f;
+		break;
+	case GLUT_KEY_UP:
+		pitch -= 5.0f;
+		break;
+	case GLUT_KEY_DOWN:
+		pitch += 5.0f;
+		break;
+	default:
+		return;
+	}
+	dirty = 1;
+}
+/* Toggle the timing overlay with 'o'.
+ */
+void keyboard(unsigned char key, int UNUSED(x), int UNUSED(y))
+{
+	if(key == 'o' || key == 'O') {
+		overlay = !overlay;
+		dirty = 1;
+	}
 }
 /* Initialize freeglut and return 0 on success.
  */
@@ -104,54 +277,57 @@ int init_glut(int argc, char **argv)
 	glutInitWindowSize(800, 600);
 	glutInitDisplayMode(GLUT_RGB|GLUT_DOUBLE|GLUT_DEPTH);
 	if(!glutCreateWindow("OBJFILE v0.01")) return 1;
-	glutTimerFunc(100, timer, 0);
+	has_timer = glutExtensionSupported("GL_ARB_timer_query") ||
+		glutExtensionSupported("GL_EXT_timer_query");
+	if(has_timer)
+		glGenQueries(2, queries);
+	next_frame = now_ms();
+	glutTimerFunc(ANIM_MS, timer, 0);
+	glutTimerFunc(0, pace, 0);
 	glutDisplayFunc(render_scene);
-	glutIdleFunc(render_scene);
 	glutReshapeFunc(change_size);
+	glutKeyboardFunc(keyboard);
+	glutSpecialFunc(special_keys);
 	return 0;
 }
+/* Print loading progress.
+ */
+static void progress(void *UNUSED(user), int percent, const char *path)
+{
+	fprintf(stderr, "Loading [%3d%%]: %s\n", percent, path);
+}
+/* Take loaded objects out of the scene manifest.
+ */
+static void collect_scene(void)
+{
+	obj = scene[0].obj;
+	obj2 = scene[1].obj;
+	obj3 = scene[2].obj;
+	anim1 = scene[3].anim;
+	anim2 = scene[4].anim;
+}
 /* Entry point for test program.
  */
 int main(int argc, char **argv)
 {
-	extern struct objfile *obj, *obj2, *obj3, **anim1;
-
 	if(init_glut(argc, argv))
 		return 1;
-	obj = init_object();
-	if(!obj) return 1;
-	if(load_object(obj, "test.obj") < 0) {
-		fprintf(stderr, "Error: Cannot load object...\n");
-		return 1;
-	}
-	obj2 = init_object();
-	if(!obj2) return 1;
-	if(load_object(obj2, "test2.obj") < 0) {
-		fprintf(stderr, "Error: Cannot load object...\n");
-		cleanup();
-		return 1;
-	}
-	obj3 = init_object();
-	if(!obj3) return 1;
-	if(load_object(obj3, "test3.obj") < 0) {
-		fprintf(stderr, "Error: Cannot load object...\n");
+	if(load_scene(scene, sizeof(scene)/sizeof(scene[0]), 0,
+			progress, NULL) != 0) {
+		fprintf(stderr, "Error: Cannot load scene...\n");
+		collect_scene();
 		cleanup();
 		return 1;
 	}
+	collect_scene();
 //	print_object(obj);
 //	print_object(obj2);
 //	print_object(obj3);
-	anim1 = load_anim("./anim", "cube_anim1", SORTASC);
-	if(anim1 == NULL) {
-		fprintf(stderr, "Error: Cannot load anim1...\n");
-		cleanup();
-		return 1;
-	}
-	anim2 = load_anim("./anim", "cube_anim1", SORTDEC);
-	if(anim2 == NULL) {
-		fprintf(stderr, "Error: Cannot load anim2...\n");
-		cleanup();
-		return 1;
+	watch = init_watch();
+	if(watch != NULL) {
+		watch_object(watch, obj, "test.obj");
+		watch_object(watch, obj2, "test2.obj");
+		watch_object(watch, obj3, "test3.obj");
 	}
 	glutMainLoop();
 	cleanup();
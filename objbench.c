@@ -0,0 +1,258 @@
+/*
+ * objbench.c - Offscreen render benchmark for the sample objects and anim/.
+ *
+ * Author: Philip R. Simonson
+ * Date  : 10/19/2026
+ *
+ *****************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define GL_GLEXT_PROTOTYPES
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glu.h>
+
+#include "object.h"
+#include "vector.h"
+
+#define WIDTH 800
+#define HEIGHT 600
+#define FRAMES 500
+#define WARMUP 10
+
+struct path {
+	const char *name;
+	int (*draw)(struct objfile *obj);	/* returns draw calls */
+};
+
+static int draw_list(struct objfile *obj);
+
+static const char *samples[] = {"test.obj", "test2.obj", "test3.obj"};
+
+static const struct path paths[] = {
+	{"list", draw_list},
+	{"arrays", draw_arrays}
+};
+
+static EGLDisplay dpy = EGL_NO_DISPLAY;
+static EGLContext ctx = EGL_NO_CONTEXT;
+static GLuint fbo, rb[2];
+
+/* Get monotonic time in seconds.
+ */
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+/* Create a surfaceless context rendering into a framebuffer object.
+ * Returns 0 on success.
+ */
+static int init_context(void)
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_display;
+	const EGLint attr[] = {EGL_NONE};
+	EGLint major, minor;
+
+	get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+		eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if(get_display != NULL)
+		dpy = get_display(EGL_PLATFORM_SURFACELESS_MESA,
+			EGL_DEFAULT_DISPLAY, NULL);
+	if(dpy == EGL_NO_DISPLAY)
+		dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if(dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+		fprintf(stderr, "Error: Cannot initialize EGL display.\n");
+		return 1;
+	}
+	if(!eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "Error: EGL has no desktop OpenGL.\n");
+		return 1;
+	}
+	ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attr);
+	if(ctx == EGL_NO_CONTEXT ||
+			!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+		fprintf(stderr, "Error: Cannot create surfaceless context.\n");
+		return 1;
+	}
+
+	glGenFramebuffers(1, &fbo);
+	glGenRenderbuffers(2, rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, rb[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, rb[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
+		WIDTH, HEIGHT);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_RENDERBUFFER, rb[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+		GL_RENDERBUFFER, rb[1]);
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+			GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Error: Cannot create framebuffer.\n");
+		return 1;
+	}
+	printf("Renderer: %s\nVersion: %s\n",
+		(const char*)glGetString(GL_RENDERER),
+		(const char*)glGetString(GL_VERSION));
+	return 0;
+}
+/* Release framebuffer and context.
+ */
+static void destroy_context(void)
+{
+	if(ctx != EGL_NO_CONTEXT) {
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteRenderbuffers(2, rb);
+		eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			EGL_NO_CONTEXT);
+		eglDestroyContext(dpy, ctx);
+	}
+	if(dpy != EGL_NO_DISPLAY)
+		eglTerminate(dpy);
+}
+/* Draw object from its GL list, counting the calls compiled into it.
+ */
+static int draw_list(struct objfile *obj)
+{
+	draw_object(obj);
+	return obj->draws;
+}
+/* Same projection and lighting as the test program.
+ */
+static void setup_view(void)
+{
+	const float col[] = {0.7,0.7,0.7,1.0};
+
+	glClearColor(0.0f, 0.0f, 0.7f, 1.0f);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glViewport(0, 0, WIDTH, HEIGHT);
+	gluPerspective(45, 1.0*WIDTH/HEIGHT, 1, 100);
+	glMatrixMode(GL_MODELVIEW);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, col);
+}
+/* Draw one object with path, counting calls and faces.
+ */
+static void draw(const struct path *p, struct objfile *obj,
+	long *calls, long *faces)
+{
+	*calls += p->draw(obj);
+	*faces += obj->nf;
+}
+/* Render the scene like the test program, returns frame time.
+ */
+static double render_frame(const struct path *p, struct objfile **objs,
+	struct objfile **anim, int frame, long *calls, long *faces)
+{
+	double t0 = now();
+
+	glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+	glLoadIdentity();
+	gluLookAt(0.0f, 0.0f, 10.0f,
+		0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f);
+	glTranslatef(-5.0f, 0.0f, -20.0f);
+	draw(p, objs[0], calls, faces);
+	glTranslatef(10.0f, 0.0f, 10.0f);
+	draw(p, objs[1], calls, faces);
+	glTranslatef(-5.0f, 0.0f, -20.0f);
+	draw(p, objs[2], calls, faces);
+	glTranslatef(-3.0f, 0.0f, 0.0f);
+	draw(p, anim[frame % vector_size(anim)], calls, faces);
+	glTranslatef(6.0f, 0.0f, 0.0f);
+	draw(p, anim[vector_size(anim)-1 - frame % vector_size(anim)],
+		calls, faces);
+	glFinish();
+	return now() - t0;
+}
+/* Sort helper for frame times.
+ */
+static int cmp_time(const void *a, const void *b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+/* Run frames with path and print its statistics.
+ */
+static void bench_path(const struct path *p, struct objfile **objs,
+	struct objfile **anim, int frames)
+{
+	long calls = 0, faces = 0;
+	double *t, total = 0.0;
+	int i;
+
+	if((t = (double*)malloc(frames*sizeof(double))) == NULL) {
+		fprintf(stderr, "Error: Out of memory.\n");
+		return;
+	}
+	for(i = 0; i < WARMUP; i++)
+		render_frame(p, objs, anim, i, &calls, &faces);
+	calls = faces = 0;
+	for(i = 0; i < frames; i++) {
+		t[i] = render_frame(p, objs, anim, i, &calls, &faces);
+		total += t[i];
+	}
+	qsort(t, frames, sizeof(double), cmp_time);
+	printf("%s\n"
+		" Frames: %d (%.1f fps)\n"
+		" Frame time: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n"
+		" Draw calls: %ld per frame\n Triangles: %ld per frame\n",
+		p->name, frames, frames/total,
+		t[frames/2]*1e3, t[frames*9/10]*1e3, t[frames*99/100]*1e3,
+		t[frames-1]*1e3, calls/frames, faces/frames);
+	free(t);
+}
+/* Entry point for render benchmark.
+ */
+int main(int argc, char **argv)
+{
+	struct objfile *objs[3] = {NULL, NULL, NULL}, **anim = NULL;
+	int i, frames = FRAMES, err = 1;
+
+	if(argc > 1 && (frames = atoi(argv[1])) <= 0) {
+		fprintf(stderr, "Usage: %s [frames]\n", argv[0]);
+		return 1;
+	}
+	if(init_context())
+		goto out;
+	for(i = 0; i < 3; i++) {
+		if((objs[i] = init_object()) == NULL)
+			goto out;
+		if(load_object(objs[i], samples[i]) != 0) {
+			fprintf(stderr, "Error: Cannot load %s.\n", samples[i]);
+			goto out;
+		}
+	}
+	anim = load_anim("./anim", "cube_anim1", SORTASC);
+	if(anim == NULL || vector_size(anim) == 0) {
+		fprintf(stderr, "Error: Cannot load animation.\n");
+		goto out;
+	}
+	setup_view();
+	for(i = 0; i < (int)(sizeof(paths)/sizeof(paths[0])); i++)
+		bench_path(&paths[i], objs, anim, frames);
+	err = 0;
+
+out:
+	for(i = 0; i < 3; i++)
+		if(objs[i] != NULL)
+			destroy_object(objs[i]);
+	if(anim != NULL)
+		destroy_anim(anim);
+	destroy_context();
+	return err;
+}
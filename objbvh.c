@@ -0,0 +1,194 @@
+/*
+ * objbvh.c - Benchmark BVH build time and query throughput on OBJ files.
+ *
+ * Author: Philip R. Simonson
+ * Date  : 10/19/2026
+ *
+ *****************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "object.h"
+#include "bvh.h"
+
+#define RAYS 200000
+#define POINTS 20000
+
+static const char *samples[] = {
+	"test.obj", "test2.obj", "test3.obj", "anim/cube_anim1_000001.obj"
+};
+
+/* Get monotonic time in seconds.
+ */
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+/* Random float in [0,1), same sequence on every run.
+ */
+static float frand(unsigned int *seed)
+{
+	*seed = *seed*1103515245u + 12345u;
+	return (*seed >> 8) / 16777216.0f;
+}
+/* Brute force ray test over every triangle, like looping over obj->f.
+ */
+static int brute_intersect(const struct objbvh *bvh, struct vec3 o,
+	struct vec3 d, int *face)
+{
+	float best = INFINITY;
+	int i, found = 0;
+
+	for(i = 0; i < bvh->ntris; i++) {
+		const struct bvh_tri *t = &bvh->tris[i];
+		struct vec3 p = {d.y*t->e2.z-d.z*t->e2.y, d.z*t->e2.x-d.x*t->e2.z,
+			d.x*t->e2.y-d.y*t->e2.x};
+		struct vec3 s = {o.x-t->a.x, o.y-t->a.y, o.z-t->a.z}, q;
+		float det = t->e1.x*p.x + t->e1.y*p.y + t->e1.z*p.z, u, v, dist;
+
+		if(fabsf(det) < 1e-12f)
+			continue;
+		u = (s.x*p.x + s.y*p.y + s.z*p.z) / det;
+		if(u < 0.0f || u > 1.0f)
+			continue;
+		q.x = s.y*t->e1.z-s.z*t->e1.y;
+		q.y = s.z*t->e1.x-s.x*t->e1.z;
+		q.z = s.x*t->e1.y-s.y*t->e1.x;
+		v = (d.x*q.x + d.y*q.y + d.z*q.z) / det;
+		if(v < 0.0f || u+v > 1.0f)
+			continue;
+		dist = (t->e2.x*q.x + t->e2.y*q.y + t->e2.z*q.z) / det;
+		if(dist > 0.0f && dist < best) {
+			best = dist;
+			*face = t->face;
+			found = 1;
+		}
+	}
+	return found;
+}
+/* Benchmark one file, returns non-zero on error.
+ */
+static int bench_file(const char *filename)
+{
+	struct vec3 *orig, *dir, center, ext;
+	double t0, build, tbvh, tbrute, tclose;
+	int i, hits, bhits, mismatch;
+	unsigned int seed = 1;
+	struct objfile *obj;
+	struct objbvh *bvh;
+	struct bvh_hit hit;
+	float radius;
+	size_t j;
+
+	if((obj = init_object()) == NULL)
+		return 1;
+	if(parse_object(obj, filename) != 0 || obj->nv == 0) {
+		destroy_object(obj);
+		return 1;
+	}
+	t0 = now();
+	bvh = build_bvh(obj);
+	build = now() - t0;
+	if(bvh == NULL) {
+		destroy_object(obj);
+		return 1;
+	}
+
+	/* Rays from a sphere around the mesh towards points inside it. */
+	center.x = center.y = center.z = 0.0f;
+	ext = center;
+	for(j = 0; j < obj->nv; j++) {
+		center.x += obj->v[j].x / obj->nv;
+		center.y += obj->v[j].y / obj->nv;
+		center.z += obj->v[j].z / obj->nv;
+	}
+	for(j = 0; j < obj->nv; j++) {
+		ext.x = fmaxf(ext.x, fabsf(obj->v[j].x-center.x));
+		ext.y = fmaxf(ext.y, fabsf(obj->v[j].y-center.y));
+		ext.z = fmaxf(ext.z, fabsf(obj->v[j].z-center.z));
+	}
+	radius = 2.0f * sqrtf(ext.x*ext.x + ext.y*ext.y + ext.z*ext.z);
+	orig = malloc(sizeof(struct vec3)*RAYS);
+	dir = malloc(sizeof(struct vec3)*RAYS);
+	if(orig == NULL || dir == NULL) {
+		free(orig);
+		free(dir);
+		destroy_bvh(bvh);
+		destroy_object(obj);
+		return 1;
+	}
+	for(i = 0; i < RAYS; i++) {
+		float a = frand(&seed)*6.2831853f, z = frand(&seed)*2.0f-1.0f;
+		float r = sqrtf(1.0f-z*z);
+		orig[i].x = center.x + radius*r*cosf(a);
+		orig[i].y = center.y + radius*r*sinf(a);
+		orig[i].z = center.z + radius*z;
+		dir[i].x = center.x + ext.x*(frand(&seed)*2.0f-1.0f) - orig[i].x;
+		dir[i].y = center.y + ext.y*(frand(&seed)*2.0f-1.0f) - orig[i].y;
+		dir[i].z = center.z + ext.z*(frand(&seed)*2.0f-1.0f) - orig[i].z;
+	}
+
+	t0 = now();
+	for(i = 0, hits = 0; i < RAYS; i++)
+		hits += bvh_intersect(bvh, orig[i], dir[i], INFINITY, &hit);
+	tbvh = now() - t0;
+
+	t0 = now();
+	for(i = 0, bhits = 0; i < RAYS/10; i++) {
+		int face = -1;
+		bhits += brute_intersect(bvh, orig[i], dir[i], &face);
+	}
+	tbrute = now() - t0;
+
+	/* Check against brute force outside the timed loops. */
+	for(i = 0, mismatch = 0; i < RAYS/10; i++) {
+		int face = -1, found;
+		found = brute_intersect(bvh, orig[i], dir[i], &face);
+		if(found != bvh_intersect(bvh, orig[i], dir[i], INFINITY, &hit) ||
+				(found && face != hit.face))
+			mismatch++;
+	}
+
+	t0 = now();
+	for(i = 0; i < POINTS; i++)
+		bvh_closest(bvh, orig[i], INFINITY, &hit);
+	tclose = now() - t0;
+
+	printf("%s\n"
+		" Triangles: %d\n Nodes: %d\n Build: %.3f ms\n"
+		" Ray queries: %.2f Mrays/s (%d/%d hit)\n"
+		" Brute force: %.2f Mrays/s (%d/%d hit, %d mismatches)\n"
+		" Closest point: %.2f Mqueries/s\n",
+		filename, bvh->ntris, bvh->nnodes, build*1e3,
+		RAYS/tbvh*1e-6, hits, RAYS,
+		(RAYS/10)/tbrute*1e-6, bhits, RAYS/10, mismatch,
+		POINTS/tclose*1e-6);
+	free(orig);
+	free(dir);
+	destroy_bvh(bvh);
+	destroy_object(obj);
+	return mismatch != 0;
+}
+/* Entry point for BVH benchmark.
+ */
+int main(int argc, char **argv)
+{
+	int i, err = 0;
+
+	if(argc < 2) {
+		for(i = 0; i < (int)(sizeof(samples)/sizeof(samples[0])); i++)
+			err |= bench_file(samples[i]);
+	} else {
+		for(i = 1; i < argc; i++)
+			err |= bench_file(argv[i]);
+	}
+	return err;
+}
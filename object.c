@@ -8,9 +8,12 @@
  * Wavefront OBJ files.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <dirent.h>
 #include <errno.h>
 
@@ -19,43 +22,50 @@
 
 #include "bitmap.h"
 #include "object.h"
+#include "archive.h"
+#include "arena.h"
+#include "source.h"
+#include "stream.h"
 #include "vector.h"
 #include "file.h"
 #include "unused.h"
 
+struct texref {
+	char path[256];
+	unsigned int tex;
+	int refs;
+};
+
+/* Textures shared by file name, only used from the GL thread. */
+static struct texref *textures;
+
+struct objparse {
+	struct objfile *obj;
+	const char *filename;
+	char **usemtl;	/* material names, faces index into this */
+	int curmat;
+};
+
 /* --------------------------- Helper Functions -------------------------- */
 
-/* Sort animation vector pointers.
+/* Compare two animation names in ascending order.
  */
-static void vsort(char *arr[], int size, int mode)
+static int cmp_asc(const void *a, const void *b)
 {
-	int i, j;
-
-	for(i = 0; i < size; i++)
-		for(j = 0; j < size; j++)
-			if(mode) {
-				if(strcmp(arr[i], arr[j]) > 0) {
-					char *tmp = arr[i];
-					arr[i] = arr[j];
-					arr[j] = tmp;
-				}
-			} else {
-				if(strcmp(arr[i], arr[j]) < 0) {
-					char *tmp = arr[i];
-					arr[i] = arr[j];
-					arr[j] = tmp;
-				}
-			}
+	return strcmp(*(char *const *)a, *(char *const *)b);
 }
-/* Count number of chars in string that occured.
+/* Compare two animation names in descending order.
  */
-static int strichr(const char *s, int ch)
+static int cmp_dec(const void *a, const void *b)
 {
-	int i;
-	for(i=0; *s; s++)
-		if(*s == ch)
-			i++;
-	return i;
+	return strcmp(*(char *const *)b, *(char *const *)a);
+}
+/* Sort animation vector pointers.
+ */
+static void vsort(char *arr[], int size, int mode)
+{
+	if(size > 1)
+		qsort(arr, size, sizeof(char*), mode ? cmp_dec : cmp_asc);
 }
 /* Create a new vector 3.
  */
@@ -69,30 +79,29 @@ static struct vec3 new_vec3(float x, float y, float z)
 }
 /* Creates a new face structure and fills it with data.
  */
-static struct face new_face(int four, int num, int mat, int f[4], int t[4])
+static struct face new_face(int num, int mat, const int f[3], const int t[3])
 {
 	struct face face;
-	face.four = four;
 	face.num = num;
 	face.mat = mat;
 	face.face.f1 = f[0];
 	face.face.f2 = f[1];
 	face.face.f3 = f[2];
-	face.face.f4 = f[3];
 	face.tex.f1 = t[0];
 	face.tex.f2 = t[1];
 	face.tex.f3 = t[2];
-	face.tex.f4 = t[3];
 	return face;
 }
 /* Creates a new material structure and fills it with data.
  */
 static struct material new_material(const char *name, float alpha,
 	float ns, float ni, float dif[], float amb[], float spec[],
-	int illum, unsigned int tex)
+	int illum, const char *map)
 {
 	struct material m;
 	strncpy(m.name, name, strlen(name)+1);
+	strncpy(m.map, map, sizeof(m.map)-1);
+	m.map[sizeof(m.map)-1] = 0;
 	m.alpha = alpha;
 	m.ns = ns;
 	m.ni = ni;
@@ -106,7 +115,7 @@ static struct material new_material(const char *name, float alpha,
 	m.spec[1] = spec[1];
 	m.spec[2] = spec[2];
 	m.illum = illum;
-	m.texture = (tex > 0 ? tex : 0);
+	m.texture = 0;
 	return m;
 }
 /* Create a new uv coordinate.
@@ -118,6 +127,162 @@ static struct texcoord new_coord(float u, float v)
 	t.v = v;
 	return t;
 }
+/* Twice the signed area of a 2D triangle, positive if counter clockwise.
+ */
+static float area2(const float *a, const float *b, const float *c)
+{
+	return (b[0]-a[0])*(c[1]-a[1]) - (b[1]-a[1])*(c[0]-a[0]);
+}
+/* Check if p is inside or on counter clockwise triangle abc.
+ */
+static int in_triangle(const float *p, const float *a, const float *b,
+	const float *c)
+{
+	return area2(a, b, p) >= 0.0f && area2(b, c, p) >= 0.0f &&
+		area2(c, a, p) >= 0.0f;
+}
+/* Split polygon with vertex indexes v into triangles, tri gets three
+ * corners (positions in v) per triangle. Convex polygons become a fan,
+ * concave ones are ear clipped in the plane of the polygon.
+ * Returns number of triangles, or -1 when out of memory.
+ */
+static int triangulate(const struct vec3 *pos, int count, const int *v,
+	int *tri)
+{
+	float pbuf[STREAM_MAXVERTS][2], (*p)[2] = pbuf;
+	float n[3] = {0.0f, 0.0f, 0.0f};
+	int ibuf[STREAM_MAXVERTS], *idx = ibuf;
+	int i, k, m, ntri = 0, axis, convex = 1;
+
+	if(count > STREAM_MAXVERTS) {
+		p = malloc(count*sizeof(*p));
+		idx = malloc(count*sizeof(int));
+		if(p == NULL || idx == NULL) {
+			free(p);
+			free(idx);
+			return -1;
+		}
+	}
+
+	/* Newell normal, then drop its largest axis keeping the winding. */
+	for(i = 0; i < count; i++) {
+		const struct vec3 *a = &pos[v[i]-1], *b = &pos[v[(i+1)%count]-1];
+		n[0] += (a->y - b->y)*(a->z + b->z);
+		n[1] += (a->z - b->z)*(a->x + b->x);
+		n[2] += (a->x - b->x)*(a->y + b->y);
+	}
+	axis = fabsf(n[0]) > fabsf(n[1]) ?
+		(fabsf(n[0]) > fabsf(n[2]) ? 0 : 2) :
+		(fabsf(n[1]) > fabsf(n[2]) ? 1 : 2);
+	for(i = 0; i < count; i++) {
+		const struct vec3 *a = &pos[v[i]-1];
+		const float c[3] = {a->x, a->y, a->z};
+		p[i][0] = c[(axis+1)%3];
+		p[i][1] = c[(axis+2)%3];
+		if(n[axis] < 0.0f)
+			p[i][0] = -p[i][0];
+		idx[i] = i;
+	}
+	for(i = 0; i < count && convex; i++)
+		if(area2(p[i], p[(i+1)%count], p[(i+2)%count]) < 0.0f)
+			convex = 0;
+
+	for(m = count; !convex && m > 3; m--) {
+		for(k = 0; k < m; k++) {
+			int a = idx[(k+m-1)%m], b = idx[k], c = idx[(k+1)%m];
+
+			if(area2(p[a], p[b], p[c]) <= 0.0f)
+				continue;
+			for(i = 0; i < m; i++) {
+				int q = idx[i];
+				if(q == a || q == b || q == c ||
+						(p[q][0] == p[a][0] && p[q][1] == p[a][1]) ||
+						(p[q][0] == p[b][0] && p[q][1] == p[b][1]) ||
+						(p[q][0] == p[c][0] && p[q][1] == p[c][1]))
+					continue;
+				if(in_triangle(p[q], p[a], p[b], p[c]))
+					break;
+			}
+			if(i == m)
+				break;
+		}
+		if(k == m)
+			break;	/* no ear, degenerate polygon: fan the rest */
+		tri[ntri*3] = idx[(k+m-1)%m];
+		tri[ntri*3+1] = idx[k];
+		tri[ntri*3+2] = idx[(k+1)%m];
+		ntri++;
+		memmove(&idx[k], &idx[k+1], (m-k-1)*sizeof(int));
+	}
+	if(convex)
+		m = count;
+	for(k = 1; k+1 < m; k++) {
+		tri[ntri*3] = idx[0];
+		tri[ntri*3+1] = idx[k];
+		tri[ntri*3+2] = idx[k+1];
+		ntri++;
+	}
+	if(p != pbuf) {
+		free(p);
+		free(idx);
+	}
+	return ntri;
+}
+/* Order submeshes by name, then by first face.
+ */
+static int cmp_submesh(const void *a, const void *b)
+{
+	const struct submesh *x = (const struct submesh*)a;
+	const struct submesh *y = (const struct submesh*)b;
+	int c = strcmp(x->name, y->name);
+
+	if(c != 0)
+		return c;
+	return x->first < y->first ? -1 : x->first > y->first;
+}
+/* Start a new submesh at the current face, an empty one is renamed.
+ */
+static void start_submesh(struct objfile *obj, const char *name)
+{
+	struct submesh sub;
+	size_t n = vector_size(obj->sub);
+
+	memset(&sub, 0, sizeof(sub));
+	snprintf(sub.name, sizeof(sub.name), "%s", name);
+	sub.first = vector_size(obj->f);
+	if(n > 0 && obj->sub[n-1].first == sub.first)
+		obj->sub[n-1] = sub;
+	else
+		vector_push_back(obj->sub, sub);
+}
+/* Close submesh ranges after parsing and sort them by name.
+ */
+static void finish_submeshes(struct objfile *obj)
+{
+	size_t i, n, nf = vector_size(obj->f);
+
+	/* Faces before the first o or g record. */
+	if(nf > 0 && (vector_size(obj->sub) == 0 || obj->sub[0].first > 0)) {
+		struct submesh sub;
+		memset(&sub, 0, sizeof(sub));
+		strcpy(sub.name, "default");
+		vector_push_back(obj->sub, sub);
+		n = vector_size(obj->sub);
+		memmove(&obj->sub[1], &obj->sub[0],
+			(n-1)*sizeof(struct submesh));
+		obj->sub[0] = sub;
+	}
+	n = vector_size(obj->sub);
+	for(i = 0; i < n; i++)
+		obj->sub[i].count = (i+1 < n ? obj->sub[i+1].first : nf) -
+			obj->sub[i].first;
+	/* A trailing record without faces. */
+	if(n > 0 && obj->sub[n-1].count == 0)
+		n--;
+	obj->nsub = n;
+	if(n > 1)
+		qsort(obj->sub, n, sizeof(struct submesh), cmp_submesh);
+}
 /* Convert anim name to object name.
  */
 static char **get_names(const char *dir_name, const char *anim_name)
@@ -140,17 +305,11 @@ static char **get_names(const char *dir_name, const char *anim_name)
 				(strstr(p->d_name, ".obj") && strstr(p->d_name, anim_name))) {
 			int len = (dir_name ? strlen(dir_name) : 2);
 			int len2 = strlen(p->d_name);
-			char *name = malloc(sizeof(char)*(len+len2+1));
+			char *name = malloc(sizeof(char)*(len+len2+2));
 			if(name != NULL) {
-				int total_len = len+len2+1;
-				strncpy(name, (dir_name != NULL ? dir_name : "./"), total_len);
-				if(dir_name != NULL) {
-					strncat(name, "/", total_len);
-					strncat(name+len+1, p->d_name, total_len);
-				} else {
-					strncat(name+len, p->d_name, total_len);
-				}
-				name[total_len] = 0;
+				snprintf(name, len+len2+2, "%s%s%s",
+					(dir_name != NULL ? dir_name : "./"),
+					(dir_name != NULL ? "/" : ""), p->d_name);
 				vector_push_back(names, name);
 			}
 		}
@@ -174,173 +333,257 @@ struct objfile *init_object(void)
 	obj->ismat = obj->istex = obj->isnorm = 0;
 	obj->v = obj->vn = NULL;
 	obj->t = NULL;
-	obj->l = -1;
+	obj->l = obj->ml = -1;
+	obj->refs = 1;
+	obj->sl = -1;
+	obj->draws = 0;
 	obj->mat = NULL;
+	obj->sub = NULL;
+	obj->lib = NULL;
+	obj->nv = obj->nvn = obj->nf = obj->nmat = obj->nt = obj->nlib = 0;
+	obj->nsub = 0;
+	obj->arena = NULL;
 	obj->f = NULL;
 	return obj;
 }
-/* Generate a GL list for drawing.
+/* Get a position, zero for a bad index.
+ */
+static struct vec3 get_vertex(const struct objfile *obj, int idx)
+{
+	if(idx < 1 || (size_t)idx > obj->nv)
+		return new_vec3(0.0f, 0.0f, 0.0f);
+	return obj->v[idx-1];
+}
+/* Write the three corners of a face as T2F_N3F_V3F vertices.
+ */
+static void fill_triangle(const struct objfile *obj, const struct face *f,
+	float *out)
+{
+	const int vi[3] = {f->face.f1, f->face.f2, f->face.f3};
+	const int ti[3] = {f->tex.f1, f->tex.f2, f->tex.f3};
+	struct vec3 p[3], n;
+	int i;
+
+	for(i = 0; i < 3; i++)
+		p[i] = get_vertex(obj, vi[i]);
+	if(f->num >= 1 && (size_t)f->num <= obj->nvn) {
+		n = obj->vn[f->num-1];
+	} else {
+		/* No normal given, use the face normal. */
+		struct vec3 a = new_vec3(p[1].x-p[0].x, p[1].y-p[0].y,
+			p[1].z-p[0].z);
+		struct vec3 b = new_vec3(p[2].x-p[0].x, p[2].y-p[0].y,
+			p[2].z-p[0].z);
+		float len;
+
+		n = new_vec3(a.y*b.z-a.z*b.y, a.z*b.x-a.x*b.z, a.x*b.y-a.y*b.x);
+		len = sqrtf(n.x*n.x + n.y*n.y + n.z*n.z);
+		if(len > 0.0f)
+			n = new_vec3(n.x/len, n.y/len, n.z/len);
+	}
+	for(i = 0; i < 3; i++, out += 8) {
+		if(ti[i] >= 1 && (size_t)ti[i] <= obj->nt) {
+			out[0] = obj->t[ti[i]-1].u;
+			out[1] = obj->t[ti[i]-1].v;
+		} else {
+			out[0] = out[1] = 0.0f;
+		}
+		out[2] = n.x;
+		out[3] = n.y;
+		out[4] = n.z;
+		out[5] = p[i].x;
+		out[6] = p[i].y;
+		out[7] = p[i].z;
+	}
+}
+/* Send a range of faces to GL as one triangle stream, drawn with one
+ * call per run of faces sharing a material.
+ * Returns number of draw calls or -1 when out of memory.
+ */
+static int emit_object(struct objfile *obj, size_t first, size_t count)
+{
+	size_t i, start;
+	int calls = 0;
+	float *buf;
+
+	if(count == 0)
+		return 0;
+	if((buf = (float*)malloc(count*24*sizeof(float))) == NULL) {
+		fprintf(stderr, "Error: Cannot draw object, out of memory.\n");
+		return -1;
+	}
+	for(i = 0; i < count; i++)
+		fill_triangle(obj, &obj->f[first+i], buf + i*24);
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glInterleavedArrays(GL_T2F_N3F_V3F, 0, buf);
+	for(start = 0; start < count; start = i) {
+		int mat = obj->f[first+start].mat;
+
+		for(i = start+1; i < count && obj->f[first+i].mat == mat; i++);
+		if(obj->ml > 0 && mat >= 0 && (size_t)mat < obj->nmat)
+			glCallList(obj->ml + mat);
+		glDrawArrays(GL_TRIANGLES, start*3, (i-start)*3);
+		calls++;
+	}
+	glPopClientAttrib();
+	free(buf);
+	return calls;
+}
+/* Generate a GL list per submesh and one drawing all of them, lists
+ * from an earlier upload are replaced.
  */
 static int make_object(struct objfile *obj)
 {
-	int unique_number;
+	int unique_number, calls;
 	size_t i;
-	int last;
 
-	/* Generate an object list for drawing later. */
-	last = -1;
-	unique_number = glGenLists(1);
-	glNewList(unique_number, GL_COMPILE);
-	for(i=0; i < vector_size(obj->f); i++) {
-		if(last != obj->f[i].mat && obj->ismat) {
-			const float dif[] = {obj->mat[obj->f[i].mat].dif[0],
-				obj->mat[obj->f[i].mat].dif[1],
-				obj->mat[obj->f[i].mat].dif[2], 1.0f};
-			const float amb[] = {obj->mat[obj->f[i].mat].amb[0],
-				obj->mat[obj->f[i].mat].amb[1],
-				obj->mat[obj->f[i].mat].amb[2], 1.0f};
-			const float spec[] = {obj->mat[obj->f[i].mat].spec[0],
-				obj->mat[obj->f[i].mat].spec[1],
-				obj->mat[obj->f[i].mat].spec[2], 1.0f};
-			const float shine = obj->mat[obj->f[i].mat].ns;
-			glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, dif);
-			glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, amb);
-			glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, spec);
-			glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, shine);
-			last = obj->f[i].mat;
-			if(!obj->mat[obj->f[i].mat].texture) {
-				glDisable(GL_TEXTURE_2D);
-			} else {
-				glEnable(GL_TEXTURE_2D);
-				glBindTexture(GL_TEXTURE_2D,
-				obj->mat[obj->f[i].mat].texture);
-			}
-		}
-		if(obj->f[i].four) {
-			glBegin(GL_QUADS);
-			if(obj->isnorm) {
-				glNormal3f(obj->vn[obj->f[i].num-1].x,
-					obj->vn[obj->f[i].num-1].y,
-					obj->vn[obj->f[i].num-1].z);
-			}
-			if(obj->istex && obj->mat[obj->f[i].mat].texture) {
-				glTexCoord2f(obj->t[obj->f[i].tex.f1-1].u,
-					obj->t[obj->f[i].tex.f1-1].v);
-			}
-			glVertex3f(obj->v[obj->f[i].face.f1-1].x,
-				obj->v[obj->f[i].face.f1-1].y,
-				obj->v[obj->f[i].face.f1-1].z);
-			if(obj->istex && obj->mat[obj->f[i].mat].texture) {
-				glTexCoord2f(obj->t[obj->f[i].tex.f2-1].u,
-					obj->t[obj->f[i].tex.f2-1].v);
-			}
-			glVertex3f(obj->v[obj->f[i].face.f2-1].x,
-				obj->v[obj->f[i].face.f2-1].y,
-				obj->v[obj->f[i].face.f2-1].z);
-			if(obj->istex && obj->mat[obj->f[i].mat].texture) {
-				glTexCoord2f(obj->t[obj->f[i].tex.f3-1].u,
-					obj->t[obj->f[i].tex.f3-1].v);
-			}
-			glVertex3f(obj->v[obj->f[i].face.f3-1].x,
-				obj->v[obj->f[i].face.f3-1].y,
-				obj->v[obj->f[i].face.f3-1].z);
-			if(obj->istex && obj->mat[obj->f[i].mat].texture) {
-				glTexCoord2f(obj->t[obj->f[i].tex.f4-1].u,
-					obj->t[obj->f[i].tex.f4-1].v);
-			}
-			glVertex3f(obj->v[obj->f[i].face.f4-1].x,
-				obj->v[obj->f[i].face.f4-1].y,
-				obj->v[obj->f[i].face.f4-1].z);
-			glEnd();
-		} else {
-			glBegin(GL_TRIANGLES);
-			if(obj->isnorm) {
-				glNormal3f(obj->vn[obj->f[i].num-1].x,
-					obj->vn[obj->f[i].num-1].y,
-					obj->vn[obj->f[i].num-1].z);
+	if(obj->l > 0)
+		glDeleteLists(obj->l, 1);
+	if(obj->sl > 0)
+		glDeleteLists(obj->sl, obj->nsub);
+	obj->sl = -1;
+	obj->draws = 0;
+	if(obj->nsub > 0) {
+		obj->sl = glGenLists(obj->nsub);
+		for(i = 0; i < obj->nsub; i++) {
+			glNewList(obj->sl + i, GL_COMPILE);
+			calls = emit_object(obj, obj->sub[i].first,
+				obj->sub[i].count);
+			glEndList();
+			if(calls < 0) {
+				glDeleteLists(obj->sl, obj->nsub);
+				obj->sl = -1;
+				obj->draws = 0;
+				return -1;
 			}
-			if(obj->istex && obj->mat[obj->f[i].mat].texture) {
-				glTexCoord2f(obj->t[obj->f[i].tex.f1-1].u,
-					obj->t[obj->f[i].tex.f1-1].v);
-			}
-			glVertex3f(obj->v[obj->f[i].face.f1-1].x,
-				obj->v[obj->f[i].face.f1-1].y,
-				obj->v[obj->f[i].face.f1-1].z);
-			if(obj->istex && obj->mat[obj->f[i].mat].texture) {
-				glTexCoord2f(obj->t[obj->f[i].tex.f2-1].u,
-					obj->t[obj->f[i].tex.f2-1].v);
-			}
-			glVertex3f(obj->v[obj->f[i].face.f2-1].x,
-				obj->v[obj->f[i].face.f2-1].y,
-				obj->v[obj->f[i].face.f2-1].z);
-			if(obj->istex && obj->mat[obj->f[i].mat].texture) {
-				glTexCoord2f(obj->t[obj->f[i].tex.f3-1].u,
-					obj->t[obj->f[i].tex.f3-1].v);
-			}
-			glVertex3f(obj->v[obj->f[i].face.f3-1].x,
-				obj->v[obj->f[i].face.f3-1].y,
-				obj->v[obj->f[i].face.f3-1].z);
-			glEnd();
+			obj->draws += calls;
 		}
 	}
+
+	/* Generate an object list for drawing later. */
+	unique_number = glGenLists(1);
+	glNewList(unique_number, GL_COMPILE);
+	for(i = 0; i < obj->nsub; i++)
+		glCallList(obj->sl + i);
 	glEndList();
 	if(glGetError() == GL_NO_ERROR)
 		return unique_number;
 	return -1;
 }
+/* Upload bitmap into texture, a new one is generated if tex is zero.
+ */
+unsigned int upload_texture(unsigned int tex, Bitmap *bmp)
+{
+	unsigned int tex_id = tex;
+
+	if(!tex_id)
+		glGenTextures(1, &tex_id);
+	glBindTexture(GL_TEXTURE_2D, tex_id);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bmp->info.width,
+		bmp->info.height, 0, GL_BGR, GL_UNSIGNED_BYTE, bmp->data);
+	if(glGetError() != GL_NO_ERROR) {
+		if(!tex)
+			glDeleteTextures(1, &tex_id);
+		return 0;
+	}
+	return tex_id;
+}
 /* Load a texture from a filename.
  */
 static unsigned int load_texture(const char *filename)
 {
-	Bitmap *bmp;
 	unsigned int tex_id;
+	Bitmap *bmp;
 
 	bmp = load_bitmap(filename);
 	if(get_last_error_bitmap() != BMP_NO_ERROR)
 		return 0;
-	glGenTextures(1, &tex_id);
-	glBindTexture(GL_TEXTURE_2D, tex_id);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bmp->info.width,
-		bmp->info.height, 0, GL_BGR, GL_UNSIGNED_BYTE, bmp->data);
+	tex_id = upload_texture(0, bmp);
 	destroy_bitmap(bmp);
-	if(glGetError() != GL_NO_ERROR)
-		return 0;
 	return tex_id;
 }
+/* Get the texture of an image file, every material mapping the same
+ * file shares it. bmp is uploaded if the file has no texture yet, a
+ * NULL bmp loads the file. Returns zero on error.
+ */
+unsigned int share_texture(const char *filename, Bitmap *bmp)
+{
+	struct texref ref;
+	size_t i;
+
+	for(i = 0; i < vector_size(textures); i++) {
+		if(!strcmp(textures[i].path, filename)) {
+			textures[i].refs++;
+			return textures[i].tex;
+		}
+	}
+	ref.tex = bmp != NULL ? upload_texture(0, bmp) : load_texture(filename);
+	if(!ref.tex)
+		return 0;
+	snprintf(ref.path, sizeof(ref.path), "%s", filename);
+	ref.refs = 1;
+	vector_push_back(textures, ref);
+	return ref.tex;
+}
+/* Drop a reference to a texture, deleting it with the last one.
+ */
+static void release_texture(unsigned int tex)
+{
+	size_t i, n = vector_size(textures);
+
+	for(i = 0; i < n; i++)
+		if(textures[i].tex == tex)
+			break;
+	if(i == n) {
+		/* Not shared, e.g. uploaded by a watch reload. */
+		glDeleteTextures(1, &tex);
+		return;
+	}
+	if(--textures[i].refs > 0)
+		return;
+	glDeleteTextures(1, &tex);
+	textures[i] = textures[n-1];
+	vector_pop_back(textures);
+	if(n == 1) {
+		vector_free(textures);
+		textures = NULL;
+	}
+}
 /* Load material library file.
  */
-static int load_material(struct objfile *obj, const char *filename)
+int parse_material(struct objfile *obj, const char *filename)
 {
 	float alpha, ns, ni, illum, dif[3], amb[3], spec[3];
-	int ismat, tex, err;
 	char name[256], fname[256];
+	struct objsource *src;
+	int ismat;
 	file_t *file;
 	char buf[256];
 
-	file = open_file(filename, "rt");
-	if((err = get_error_file()) != FILE_ERROR_OKAY) {
-		fprintf(stderr, "Error: %s\n", strerror_file(err));
+	if((src = open_source(filename)) == NULL)
+		return 1;
+	/* Check the handle, the library's last error is shared between
+	 * threads loading materials at the same time.
+	 */
+	if((file = open_file(source_path(src), "rt")) == NULL) {
+		fprintf(stderr, "Error: Cannot open %s.\n", source_path(src));
+		close_source(src);
 		return 1;
 	}
-	ismat = tex = 0;
+	ismat = 0;
 	strcpy(fname, "\0");
 	while(readf_file(file, "%s", buf) != EOF) {
 		if(!strcmp(buf, "newmtl")) {
 			if(ismat) {
-				if(!strcmp(fname, "")) {
-					vector_push_back(obj->mat,
-					new_material(name, alpha, ns, ni, dif,
-					amb, spec, illum, -1));
-				} else {
-					vector_push_back(obj->mat,
-					new_material(name, alpha, ns, ni, dif,
-					amb, spec, illum, tex));
-					strcpy(fname, "\0");
-				}
+				vector_push_back(obj->mat,
+				new_material(name, alpha, ns, ni, dif,
+				amb, spec, illum, fname));
+				strcpy(fname, "\0");
 			}
-			ismat = tex = 0;
+			ismat = 0;
 			memset(name, 0, sizeof(name));
 			readf_file(file, "%s", name);
 		} else if(!strcmp(buf, "Ns")) {
@@ -369,157 +612,296 @@ static int load_material(struct objfile *obj, const char *filename)
 			ismat = 1;
 		} else if(!strcmp(buf, "map_Kd")) {
 			readf_file(file, "%s", fname);
-			tex = load_texture(fname);
 			ismat = 1;
 		}
 	}
+	close_file(file);
+	if(close_source(src)) {
+		fprintf(stderr, "Error: %s: Corrupt compressed data.\n", filename);
+		return 1;
+	}
 	if(ismat) {
-		if(!strcmp(fname, "")) {
-			vector_push_back(obj->mat,
-			new_material(name, alpha, ns, ni, dif, amb,
-			spec, illum, -1));
-		} else {
-			vector_push_back(obj->mat,
-			new_material(name, alpha, ns, ni, dif, amb,
-			spec, illum, tex));
-			strcpy(fname, "\0");
-		}
+		vector_push_back(obj->mat,
+		new_material(name, alpha, ns, ni, dif, amb,
+		spec, illum, fname));
 	}
-	if(vector_size(obj->mat) == 0)
+	obj->nmat = vector_size(obj->mat);
+	if(obj->nmat == 0)
 		obj->ismat = 0;
 	else
 		obj->ismat = 1;
 	return 0;
 }
-/* Create object from file.
+/* Add a vertex position while parsing.
  */
-int load_object(struct objfile *obj, const char *filename)
+static int on_vertex(void *user, float x, float y, float z)
 {
-	int curmat, err;
-	file_t *file;
-	char buf[256];
+	struct objparse *ps = (struct objparse*)user;
+	vector_push_back(ps->obj->v, new_vec3(x, y, z));
+	return 0;
+}
+/* Add a vertex normal while parsing.
+ */
+static int on_normal(void *user, float x, float y, float z)
+{
+	struct objparse *ps = (struct objparse*)user;
+	vector_push_back(ps->obj->vn, new_vec3(x, y, z));
+	ps->obj->isnorm = 1;
+	return 0;
+}
+/* Add a texture coordinate while parsing.
+ */
+static int on_texcoord(void *user, float u, float v)
+{
+	struct objparse *ps = (struct objparse*)user;
+	vector_push_back(ps->obj->t, new_coord(u, 1-v));
+	ps->obj->istex = 1;
+	return 0;
+}
+/* Triangulate a face of any size and add its triangles. Faces that
+ * use missing vertices are skipped.
+ */
+static int on_face(void *user, int count, const int *v, const int *t,
+	const int *n)
+{
+	struct objparse *ps = (struct objparse*)user;
+	struct objfile *obj = ps->obj;
+	size_t nv = vector_size(obj->v), nvn = vector_size(obj->vn);
+	size_t nt = vector_size(obj->t);
+	int buf[3*(STREAM_MAXVERTS-2)], *tri = buf, i, k, ntri, num = 0;
+
+	if(count < 3)
+		return 0;
+	for(i = 0; i < count; i++) {
+		if(v[i] < 1 || (size_t)v[i] > nv)
+			return 0;
+		/* One normal per face, the last one given. */
+		if(n[i] >= 1 && (size_t)n[i] <= nvn)
+			num = n[i];
+	}
+	if(count > STREAM_MAXVERTS &&
+			(tri = malloc(3*(count-2)*sizeof(int))) == NULL) {
+		fprintf(stderr, "Warning: Skipped face, out of memory.\n");
+		return 0;
+	}
+	ntri = count == 3 ? 1 : triangulate(obj->v, count, v, tri);
+	if(count == 3) {
+		tri[0] = 0;
+		tri[1] = 1;
+		tri[2] = 2;
+	}
+	for(k = 0; k < ntri; k++) {
+		int f[3], tc[3];
+
+		for(i = 0; i < 3; i++) {
+			int c = tri[k*3+i];
+			f[i] = v[c];
+			tc[i] = (t[c] >= 1 && (size_t)t[c] <= nt) ? t[c] : 0;
+		}
+		vector_push_back(obj->f, new_face(num, ps->curmat, f, tc));
+	}
+	if(ntri < 0)
+		fprintf(stderr, "Warning: Skipped face, out of memory.\n");
+	if(tri != buf)
+		free(tri);
+	return 0;
+}
+/* Switch current material while parsing, the name is only recorded
+ * and looked up later by resolve_materials().
+ */
+static int on_usemtl(void *user, const char *name)
+{
+	struct objparse *ps = (struct objparse*)user;
+	size_t i, n = vector_size(ps->usemtl);
+	char *copy;
+
+	for(i = 0; i < n; i++) {
+		if(!strcmp(ps->usemtl[i], name)) {
+			ps->curmat = i;
+			return 0;
+		}
+	}
+	if((copy = malloc(strlen(name)+1)) == NULL)
+		return 0;
+	strcpy(copy, name);
+	vector_push_back(ps->usemtl, copy);
+	ps->curmat = n;
+	return 0;
+}
+/* Record material libraries named relative to the object file.
+ */
+static int on_mtllib(void *user, const char *names)
+{
+	struct objparse *ps = (struct objparse*)user;
+	const char *dir = strrchr(ps->filename, '/');
+	char buf[256], *name, *save;
+
+	snprintf(buf, sizeof(buf), "%s", names);
+	ps->obj->ismat = 1;
+	for(name = strtok_r(buf, " \t", &save); name != NULL;
+			name = strtok_r(NULL, " \t", &save)) {
+		char path[512], found[512], *lib;
+
+		if(dir != NULL)
+			snprintf(path, sizeof(path), "%.*s/%s",
+				(int)(dir-ps->filename), ps->filename, name);
+		else
+			snprintf(path, sizeof(path), "%s", name);
+		find_source(path, found, sizeof(found));
+		if((lib = malloc(strlen(found)+1)) != NULL) {
+			strcpy(lib, found);
+			vector_push_back(ps->obj->lib, lib);
+		}
+	}
+	return 0;
+}
+/* Start a named submesh while parsing.
+ */
+static int on_group(void *user, const char *name)
+{
+	struct objparse *ps = (struct objparse*)user;
+	start_submesh(ps->obj, name[0] != 0 ? name : "default");
+	return 0;
+}
+/* Parse geometry from file without loading its material libraries.
+ * Their paths are left in obj->lib and each face's material is an
+ * index into the usemtl names returned, see resolve_materials().
+ */
+int parse_geometry(struct objfile *obj, const char *filename, char ***usemtl)
+{
+	struct objstream cb;
+	struct objparse ps;
 
-	file = open_file(filename, "rt");
-	if((err = get_error_file()) != FILE_ERROR_OKAY) {
-		fprintf(stderr, "Error: %s\n", strerror_file(err));
+	ps.obj = obj;
+	ps.filename = filename;
+	ps.usemtl = NULL;
+	ps.curmat = -1;
+	memset(&cb, 0, sizeof(cb));
+	cb.user = &ps;
+	cb.vertex = on_vertex;
+	cb.normal = on_normal;
+	cb.texcoord = on_texcoord;
+	cb.face = on_face;
+	cb.usemtl = on_usemtl;
+	cb.mtllib = on_mtllib;
+	cb.group = on_group;
+	if(stream_object(filename, &cb) != 0) {
+		free_anim_names(ps.usemtl);
 		return 1;
 	}
-	curmat = 0;
-	while(readf_file(file, "%s", buf) != EOF) {
-		char tmpname[256];
-
-		if(!strcmp(buf, "v")) {
-			float x, y, z;
-			readf_file(file, "%f %f %f", &x, &y, &z);
-			vector_push_back(obj->v, new_vec3(x, y, z));
-		} else if(!strcmp(buf, "vn")) {
-			float x, y, z;
-			readf_file(file, "%f %f %f", &x, &y, &z);
-			vector_push_back(obj->vn, new_vec3(x, y, z));
-			obj->isnorm = 1;
-		} else if(!strcmp(buf, "f")) {
-			int f[4], t[4], num, four;
-			if(gets_file(file, buf, sizeof(buf)) == NULL)
-				continue;
-			if(strichr(buf, ' ') == 4) {
-				four = 1;
-				if(strstr(buf, "//") != NULL) {
-					sscanf(buf,
-					"%d//%d %d//%d %d//%d %d//%d",
-					&f[0], &num, &f[1],
-					&num, &f[2], &num,
-					&f[3], &num);
-					t[0]=t[1]=t[2]=t[3]=0;
-					vector_push_back(obj->f,
-					new_face(four, num, curmat, f, t));
-				} else if(strstr(buf, "/") != NULL) {
-					sscanf(buf,
-					"%d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-					&f[0], &t[0], &num,
-					&f[1], &t[1], &num,
-					&f[2], &t[2], &num,
-					&f[3], &t[3], &num);
-					vector_push_back(obj->f,
-					new_face(four, num, curmat, f, t));
-				} else {
-					sscanf(buf,
-					"%d %d %d %d",
-					&f[0], &f[2], &f[3],
-					&f[4]);
-					t[0]=t[1]=t[2]=t[3]=0;
-					vector_push_back(obj->f,
-					new_face(four, -1, curmat, f, t));
-				}
-			} else {
-				four = 0;
-				if(strstr(buf, "//") != NULL) {
-					sscanf(buf, "%d//%d %d//%d %d//%d",
-					&f[0], &num, &f[1],
-					&num, &f[2], &num);
-					f[4] = 0;
-					t[0]=t[1]=t[2]=t[3]=0;
-					vector_push_back(obj->f,
-					new_face(four, num, curmat, f, t));
-				} else if(strstr(buf, "/") != NULL) {
-					sscanf(buf,
-					"%d/%d/%d %d/%d/%d %d/%d/%d",
-					&f[0], &t[0], &num,
-					&f[1], &t[1], &num,
-					&f[2], &t[2], &num);
-					f[3] = 0;
-					t[3] = 0;
-					vector_push_back(obj->f,
-					new_face(four, num, curmat, f, t));
-				} else {
-					sscanf(buf,
-					"%d %d %d",
-					&f[0], &f[1], &f[2]);
-					t[0]=t[1]=t[2]=t[3]=0;
-					f[4] = 0;
-					vector_push_back(obj->f,
-					new_face(four, -1, curmat, f, t));
-				}
-			}
-		} else if(!strcmp(buf, "vt")) {
-			float u, v;
-			readf_file(file, "%f %f", &u, &v);
-			vector_push_back(obj->t, new_coord(u, 1-v));
-			obj->istex = 1;
-		} else if(!strcmp(buf, "usemtl")) {
-			size_t i;
-
-			memset(tmpname, 0, sizeof(tmpname));
-			readf_file(file, "%s", tmpname);
-			for(i=0; i<vector_size(obj->mat); i++) {
-				if(!strcmp(obj->mat[i].name, tmpname)) {
-					curmat = i;
-					break;
-				}
-			}
-		} else if(!strcmp(buf, "mtllib")) {
-			char *dir = strrchr(filename, '/');
-			memset(tmpname, 0, sizeof(tmpname));
-			readf_file(file, "%s", tmpname);
-			obj->ismat = 1;
-			if(dir != NULL) {
-				char path[512];
-				memset(path, 0, sizeof(path));
-				strncpy(path, filename, dir-filename);
-				strncat(path, "/", 2);
-				strncat(path, tmpname, strlen(tmpname));
-				if(load_material(obj, path)) {
-					fprintf(stderr, "Warning: Could not load material: %s\n", path);
-				}
-			} else {
-				if(load_material(obj, tmpname)) {
-					fprintf(stderr, "Warning: Could not load mtllib: %s\n", tmpname);
-				}
+	obj->nv = vector_size(obj->v);
+	obj->nvn = vector_size(obj->vn);
+	obj->nf = vector_size(obj->f);
+	obj->nmat = vector_size(obj->mat);
+	obj->nt = vector_size(obj->t);
+	obj->nlib = vector_size(obj->lib);
+	finish_submeshes(obj);
+	*usemtl = ps.usemtl;
+	return 0;
+}
+/* Turn usemtl name indices left by parse_geometry() into indices of
+ * loaded materials. Faces before any usemtl get the first material,
+ * an unknown name keeps the previous one.
+ */
+int resolve_materials(struct objfile *obj, char **usemtl)
+{
+	size_t i, j, n = vector_size(usemtl);
+	int *map = NULL, last = 0;
+
+	obj->nmat = vector_size(obj->mat);
+	if(n > 0 && (map = malloc(n*sizeof(int))) == NULL) {
+		fprintf(stderr, "Error: Out of memory.\n");
+		return -1;
+	}
+	for(i = 0; i < n; i++) {
+		map[i] = -1;
+		for(j = 0; j < obj->nmat; j++) {
+			if(!strcmp(obj->mat[j].name, usemtl[i])) {
+				map[i] = j;
+				break;
 			}
 		}
-		strcpy(tmpname, "");
 	}
-	close_file(file);
+	for(i = 0; i < obj->nf; i++) {
+		int k = obj->f[i].mat;
+
+		if(k >= 0 && (size_t)k < n && map[k] >= 0)
+			last = map[k];
+		obj->f[i].mat = last;
+	}
+	free(map);
+	return 0;
+}
+/* Parse object and its material libraries without touching OpenGL.
+ */
+int parse_object(struct objfile *obj, const char *filename)
+{
+	char **usemtl;
+	size_t i;
+	int err;
+
+	if(parse_geometry(obj, filename, &usemtl) != 0)
+		return 1;
+	for(i = 0; i < obj->nlib; i++)
+		if(parse_material(obj, obj->lib[i]))
+			fprintf(stderr, "Warning: Could not load mtllib: %s\n",
+				obj->lib[i]);
+	err = resolve_materials(obj, usemtl);
+	free_anim_names(usemtl);
+	return err ? 1 : 0;
+}
+/* Load missing textures and (re)build the GL lists for each material.
+ */
+int upload_materials(struct objfile *obj)
+{
+	size_t i;
+
+	if(!obj->ismat || obj->nmat == 0)
+		return 0;
+	if(obj->ml <= 0)
+		obj->ml = glGenLists(obj->nmat);
+	for(i=0; i<obj->nmat; i++) {
+		const struct material *m = &obj->mat[i];
+		const float dif[] = {m->dif[0], m->dif[1], m->dif[2], 1.0f};
+		const float amb[] = {m->amb[0], m->amb[1], m->amb[2], 1.0f};
+		const float spec[] = {m->spec[0], m->spec[1], m->spec[2], 1.0f};
+
+		if(m->map[0] != 0 && !m->texture)
+			obj->mat[i].texture = share_texture(m->map, NULL);
+		glNewList(obj->ml + i, GL_COMPILE);
+		glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, dif);
+		glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, amb);
+		glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, spec);
+		glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, m->ns);
+		if(!m->texture) {
+			glDisable(GL_TEXTURE_2D);
+		} else {
+			glEnable(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, m->texture);
+		}
+		glEndList();
+	}
+	return glGetError() == GL_NO_ERROR ? 0 : -1;
+}
+/* Load material textures and build the GL list for a parsed object.
+ */
+int upload_object(struct objfile *obj)
+{
+	int err;
+
+	err = upload_materials(obj);
 	obj->l = make_object(obj);
+	return (err || obj->l < 0) ? -1 : 0;
+}
+/* Create object from file.
+ */
+int load_object(struct objfile *obj, const char *filename)
+{
+	int err;
+
+	if((err = parse_object(obj, filename)) != 0)
+		return err;
+	upload_object(obj);
 	return 0;
 }
 /* Draw object to screen.
@@ -528,6 +910,73 @@ void draw_object(struct objfile *obj)
 {
 	glCallList(obj->l);
 }
+/* Draw object from vertex arrays without its GL list, materials must
+ * be uploaded. Returns number of draw calls.
+ */
+int draw_arrays(struct objfile *obj)
+{
+	return emit_object(obj, 0, obj->nf);
+}
+/* Find first submesh with name, returns its index or -1.
+ */
+int find_submesh(const struct objfile *obj, const char *name)
+{
+	size_t lo = 0, hi = obj->nsub;
+
+	while(lo < hi) {
+		size_t mid = lo + (hi-lo)/2;
+		if(strcmp(obj->sub[mid].name, name) < 0)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	if(lo < obj->nsub && !strcmp(obj->sub[lo].name, name))
+		return (int)lo;
+	return -1;
+}
+/* Draw one submesh of object.
+ */
+void draw_submesh(struct objfile *obj, int sub)
+{
+	if(sub < 0 || (size_t)sub >= obj->nsub || obj->sl <= 0)
+		return;
+	glCallList(obj->sl + sub);
+}
+/* Draw chosen submeshes of object with a single call, indexes out of
+ * range are skipped.
+ */
+void draw_submeshes(struct objfile *obj, const int *subs, int count)
+{
+	int i;
+
+	if(obj->sl <= 0 || count <= 0)
+		return;
+	for(i = 0; i < count; i++)
+		if(subs[i] < 0 || (size_t)subs[i] >= obj->nsub)
+			break;
+	if(i < count) {
+		/* Bad index would call another object's list, skip it. */
+		for(i = 0; i < count; i++)
+			draw_submesh(obj, subs[i]);
+		return;
+	}
+	glListBase(obj->sl);
+	glCallLists(count, GL_INT, subs);
+	glListBase(0);
+}
+/* Draw every submesh named name, returns how many were drawn.
+ */
+int draw_group(struct objfile *obj, const char *name)
+{
+	int i, first = find_submesh(obj, name);
+
+	if(first < 0)
+		return 0;
+	for(i = first; (size_t)i < obj->nsub &&
+			!strcmp(obj->sub[i].name, name); i++)
+		draw_submesh(obj, i);
+	return i - first;
+}
 /* Print object data.
  */
 void print_object(struct objfile *obj)
@@ -536,77 +985,44 @@ void print_object(struct objfile *obj)
 	printf("Below is all the data... (Vertices, Normals, Faces).\n"
 		"In that order.\n"
 		"=====================================================\n");
-	for(i=0; i < vector_size(obj->v); i++) {
+	for(i=0; i < obj->nv; i++) {
 		printf("%f %f %f\n", obj->v[i].x,
 			obj->v[i].y, obj->v[i].z);
 	}
 	printf("=====================================================\n");
 	if(obj->isnorm) {
-		for(i=0; i < vector_size(obj->vn); i++) {
+		for(i=0; i < obj->nvn; i++) {
 			printf("%f %f %f\n", obj->vn[i].x,
 				obj->vn[i].y, obj->vn[i].z);
 		}
 		printf("=====================================================\n");
 	}
-	for(i=0; i < vector_size(obj->f); i++) {
-		if(obj->f[i].four) {
-			if(obj->f[i].tex.f1 == 0 && obj->f[i].num) {
-				printf("Quad: %d\n"
-				"%d//%d %d//%d %d//%d %d//%d\n",
-				obj->f[i].four,
-				obj->f[i].face.f1, obj->f[i].num,
-				obj->f[i].face.f2, obj->f[i].num,
-				obj->f[i].face.f3, obj->f[i].num,
-				obj->f[i].face.f4, obj->f[i].num);
-			} else if(obj->f[i].tex.f1 && obj->f[i].num) {
-				printf("Quad: %d\n"
-				"%d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
-				obj->f[i].four,
-				obj->f[i].face.f1, obj->f[i].tex.f1,
-				obj->f[i].num,
-				obj->f[i].face.f2, obj->f[i].tex.f2,
-				obj->f[i].num,
-				obj->f[i].face.f3, obj->f[i].tex.f3,
-				obj->f[i].num,
-				obj->f[i].face.f4, obj->f[i].tex.f4,
-				obj->f[i].num);
-			} else {
-				printf("Quad: %d\n"
-				"%d %d %d %d\n",
-				obj->f[i].four,
-				obj->f[i].face.f1, obj->f[i].face.f2,
-				obj->f[i].face.f3, obj->f[i].face.f4);
-			}
+	for(i=0; i < obj->nf; i++) {
+		if(obj->f[i].tex.f1 == 0 && obj->f[i].num) {
+			printf("Triangle:\n"
+			"%d//%d %d//%d %d//%d\n",
+			obj->f[i].face.f1, obj->f[i].num,
+			obj->f[i].face.f2, obj->f[i].num,
+			obj->f[i].face.f3, obj->f[i].num);
+		} else if(obj->f[i].tex.f1 && obj->f[i].num) {
+			printf("Triangle:\n"
+			"%d/%d/%d %d/%d/%d %d/%d/%d\n",
+			obj->f[i].face.f1, obj->f[i].tex.f1,
+			obj->f[i].num,
+			obj->f[i].face.f2, obj->f[i].tex.f2,
+			obj->f[i].num,
+			obj->f[i].face.f3, obj->f[i].tex.f3,
+			obj->f[i].num);
 		} else {
-			if(obj->f[i].tex.f1 == 0 && obj->f[i].num) {
-				printf("Quad: %d\n"
-				"%d//%d %d//%d %d//%d\n",
-				obj->f[i].four,
-				obj->f[i].face.f1, obj->f[i].num,
-				obj->f[i].face.f2, obj->f[i].num,
-				obj->f[i].face.f3, obj->f[i].num);
-			} else if(obj->f[i].tex.f1 && obj->f[i].num) {
-				printf("Quad: %d\n"
-				"%d/%d/%d %d/%d/%d %d/%d/%d\n",
-				obj->f[i].four,
-				obj->f[i].face.f1, obj->f[i].tex.f1,
-				obj->f[i].num,
-				obj->f[i].face.f2, obj->f[i].tex.f2,
-				obj->f[i].num,
-				obj->f[i].face.f3, obj->f[i].tex.f3,
-				obj->f[i].num);
-			} else {
-				printf("Quad: %d\n"
-				"%d %d %d\n",
-				obj->f[i].four,
-				obj->f[i].face.f1, obj->f[i].face.f2,
-				obj->f[i].face.f3);
-			}
+			printf("Triangle:\n"
+			"%d %d %d\n",
+			obj->f[i].face.f1, obj->f[i].face.f2,
+			obj->f[i].face.f3);
 		}
 	}
 	printf("=====================================================\n");
 	if(obj->ismat) {
-		for(i=0; i<vector_size(obj->mat); i++) {
+		for(i=0; i<obj->nmat; i++) {
 			printf("Name: %s\nAlpha: %f\nNs: %f\nNi: %f\n"
 				"Diffuse: %f %f %f\n"
 				"Ambient: %f %f %f\n"
@@ -623,23 +1039,69 @@ void print_object(struct objfile *obj)
 		printf("=====================================================\n");
 	}
 	if(obj->istex) {
-		for(i=0; i<vector_size(obj->t); i++) {
+		for(i=0; i<obj->nt; i++) {
 			printf("Texture UV Coords: %f %f\n",
 				obj->t[i].u, obj->t[i].v);
 		}
 		printf("=====================================================\n");
-		for(i=0; i<vector_size(obj->f); i++) {
-			printf("Face Number: %d\nTexture Material Indexes [1-4]:\n"
-				"%d %d %d %d\n", obj->f[i].num,
+		for(i=0; i<obj->nf; i++) {
+			printf("Face Number: %d\nTexture Material Indexes [1-3]:\n"
+				"%d %d %d\n", obj->f[i].num,
 				obj->f[i].tex.f1,
 				obj->f[i].tex.f2,
-				obj->f[i].tex.f3,
-				obj->f[i].tex.f4
+				obj->f[i].tex.f3
 			);
 		}
 		printf("=====================================================\n");
 	}
 }
+/* Get the sorted frame file names of an animation.
+ */
+char **get_anim_names(const char *dir, const char *anim_name, int mode)
+{
+	char **names;
+
+	if((names = get_names(dir, anim_name)) != NULL)
+		vsort(names, vector_size(names), mode);
+	return names;
+}
+/* Free names returned by get_anim_names().
+ */
+void free_anim_names(char **names)
+{
+	size_t i;
+
+	for(i = 0; i < vector_size(names); i++)
+		free(names[i]);
+	vector_free(names);
+}
+/* Load an animation from a packed archive, returns NULL if there is none.
+ */
+static struct objfile **load_anim_archive(const char *dir,
+	const char *anim_name, int mode)
+{
+	struct objfile **anim = NULL;
+	struct objarchive *ar;
+	char path[512];
+	int i, frames;
+
+	snprintf(path, sizeof(path), "%s/%s%s", (dir != NULL ? dir : "."),
+		anim_name, ARCHIVE_EXT);
+	if((ar = open_archive(path)) == NULL)
+		return NULL;
+	frames = archive_frames(ar);
+	for(i = 0; i < frames; i++) {
+		int index = (mode == SORTDEC ? frames-i-1 : i);
+		struct objfile *frame = load_archive_frame(ar, index);
+		if(frame == NULL) {
+			fprintf(stderr, "Frame [FAIL]: %d - %s\n", index, path);
+			continue;
+		}
+		vector_push_back(anim, frame);
+	}
+	close_archive(ar);
+	return anim;
+}
 /* Load an animation from it's name.
  */
 struct objfile **load_anim(const char *dir, const char *anim_name, int mode)
@@ -648,8 +1110,9 @@ struct objfile **load_anim(const char *dir, const char *anim_name, int mode)
 	char **names = NULL;
 
 	printf("Loading animation: %s\n", anim_name);
-	if((names = get_names(dir, anim_name)) != NULL) {
-		vsort(names, vector_size(names), mode);
+	if((anim = load_anim_archive(dir, anim_name, mode)) != NULL)
+		return anim;
+	if((names = get_anim_names(dir, anim_name, mode)) != NULL) {
 		for(size_t i = 0; i < vector_size(names); i++) {
 			struct objfile *frame = init_object();
 			if(frame != NULL) {
@@ -661,9 +1124,7 @@ struct objfile **load_anim(const char *dir, const char *anim_name, int mode)
 				fprintf(stderr, "Frame [DONE]: %lu - %s\n", i, names[i]);
 			}
 		}
-		for(size_t i = 0; i < vector_size(names); i++)
-			free(names[i]);
-		vector_free(names);
+		free_anim_names(names);
 	}
 	return anim;
 }
@@ -671,34 +1132,69 @@ struct objfile **load_anim(const char *dir, const char *anim_name, int mode)
  */
 void draw_anim(struct objfile **anim, int frame)
 {
-	if(frame < 0 || frame > (int)vector_size(anim)) return;
+	if(frame < 0 || frame >= (int)vector_size(anim)) return;
 	draw_object(anim[frame]);
 }
 /* Destroy given animation.
  */
 void destroy_anim(struct objfile **anim)
 {
+	struct objarena *shared = NULL;
 	size_t i;
 
-	for(i = 0; i < vector_size(anim); i++)
+	for(i = 0; i < vector_size(anim); i++) {
+		if(anim[i]->arena != NULL && anim[i]->arena->owner == NULL)
+			shared = anim[i]->arena;
 		destroy_object(anim[i]);
+	}
+	destroy_arena(shared);
 	vector_free(anim);
 }
+/* Release GL lists and textures held by object.
+ */
+void unload_object(struct objfile *obj)
+{
+	size_t i;
+
+	for(i=0; i<obj->nmat; i++) {
+		if(obj->mat[i].texture)
+			release_texture(obj->mat[i].texture);
+		obj->mat[i].texture = 0;
+	}
+	if(obj->ml > 0)
+		glDeleteLists(obj->ml, obj->nmat);
+	if(obj->sl > 0)
+		glDeleteLists(obj->sl, obj->nsub);
+	if(obj->l > 0)
+		glDeleteLists(obj->l, 1);
+	obj->l = obj->ml = obj->sl = -1;
+	obj->draws = 0;
+}
 /* Destroy given object structure.
  */
 void destroy_object(struct objfile *obj)
 {
 	size_t i;
 
-	for(i=0; i<vector_size(obj->mat); i++)
-		glDeleteTextures(1, &obj->mat[i].texture);
-	glDeleteLists(1, obj->l);
+	if(--obj->refs > 0)
+		return;
+	unload_object(obj);
+	if(obj->arena != NULL) {
+		/* Arrays and header live in the arena. */
+		if(obj->arena->owner == obj)
+			destroy_arena(obj->arena);
+		return;
+	}
+	/* nlib is not set yet when parse_geometry() fails. */
+	for(i=0; i<vector_size(obj->lib); i++)
+		free(obj->lib[i]);
+	vector_free(obj->lib);
 	vector_free(obj->v);
 	vector_free(obj->vn);
 	vector_free(obj->f);
 	vector_free(obj->mat);
 	vector_free(obj->t);
+	vector_free(obj->sub);
 	memset(obj, 0, sizeof(struct objfile));
 	free(obj);
 }
-
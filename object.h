@@ -5,13 +5,17 @@
  * @brief Blender wavefront OBJ loader.
  *
  * @details This is a simple object file format loader for
- * Wavefront OBJ files.
+ * Wavefront OBJ files. Faces of any size are split into triangles
+ * while parsing, so obj->f only holds triangles.
  */
 
 #ifndef PRS_OBJECT_H
 #define PRS_OBJECT_H
 
+#include <stddef.h>
+
 #include "export.h"
+#include "bitmap.h"
 
 enum { SORTASC, SORTDEC };
 
@@ -22,12 +26,10 @@ struct vec3 {
 };
 
 struct face {
-	char four;
 	int num;
 	int mat;
 	struct {
-		int f1, f2;
-		int f3, f4;
+		int f1, f2, f3;
 	} face, tex;
 };
 
@@ -35,6 +37,7 @@ struct material {
 	char name[256];
 	float alpha, ns, ni;
 	float dif[3], amb[3], spec[3];
+	char map[256];
 	unsigned int texture;
 	int illum;
 };
@@ -43,13 +46,25 @@ struct texcoord {
 	float u, v;
 };
 
+struct submesh {
+	char name[256];
+	size_t first, count;	/* range of faces in obj->f */
+};
+
+struct objarena;
+
 struct objfile {
 	struct vec3 *v;
 	struct vec3 *vn;
 	struct face *f;
 	struct material *mat;
 	struct texcoord *t;
-	int l;
+	struct submesh *sub;	/* sorted by name, then by first face */
+	char **lib;
+	size_t nv, nvn, nf, nmat, nt, nlib, nsub;
+	struct objarena *arena;
+	int l, ml, sl, refs;
+	int draws;		/* glDrawArrays calls in the GL list */
 	char istex;
 	char isnorm;
 	char ismat;
@@ -61,12 +76,28 @@ extern "C" {
 
 PRS_EXPORT struct objfile *init_object(void);
 PRS_EXPORT int load_object(struct objfile *obj, const char*);
+PRS_EXPORT int parse_object(struct objfile *obj, const char*);
+PRS_EXPORT int parse_geometry(struct objfile *obj, const char*, char ***usemtl);
+PRS_EXPORT int resolve_materials(struct objfile *obj, char **usemtl);
+PRS_EXPORT int upload_object(struct objfile *obj);
+PRS_EXPORT int parse_material(struct objfile *obj, const char*);
+PRS_EXPORT int upload_materials(struct objfile *obj);
+PRS_EXPORT unsigned int upload_texture(unsigned int tex, Bitmap *bmp);
+PRS_EXPORT unsigned int share_texture(const char *filename, Bitmap *bmp);
+PRS_EXPORT void unload_object(struct objfile*);
 PRS_EXPORT void destroy_object(struct objfile*);
 PRS_EXPORT void draw_object(struct objfile*);
+PRS_EXPORT int draw_arrays(struct objfile*);
+PRS_EXPORT int find_submesh(const struct objfile *obj, const char *name);
+PRS_EXPORT void draw_submesh(struct objfile *obj, int sub);
+PRS_EXPORT void draw_submeshes(struct objfile *obj, const int *subs, int count);
+PRS_EXPORT int draw_group(struct objfile *obj, const char *name);
 PRS_EXPORT void print_object(struct objfile*);
 PRS_EXPORT struct objfile **load_anim(const char *dir, const char *anim_name, int mode);
 PRS_EXPORT void draw_anim(struct objfile **anim, int frame);
 PRS_EXPORT void destroy_anim(struct objfile **anim);
+PRS_EXPORT char **get_anim_names(const char *dir, const char *anim_name, int mode);
+PRS_EXPORT void free_anim_names(char **names);
 
 #ifdef __cplusplus
 }
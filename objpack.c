@@ -0,0 +1,34 @@
+/*
+ * objpack.c - Pack an animation's OBJ frames into a single archive.
+ *
+ * Author: Philip R. Simonson
+ * Date  : 10/19/2026
+ *
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "archive.h"
+
+/* Entry point for archive packer.
+ */
+int main(int argc, char **argv)
+{
+	char path[512];
+
+	if(argc < 3 || argc > 4) {
+		fprintf(stderr, "Usage: %s <dir> <anim_name> [archive]\n", argv[0]);
+		return 1;
+	}
+	if(argc == 4)
+		snprintf(path, sizeof(path), "%s", argv[3]);
+	else
+		snprintf(path, sizeof(path), "%s/%s%s", argv[1], argv[2],
+			ARCHIVE_EXT);
+	if(pack_anim(argv[1], argv[2], path))
+		return 1;
+	printf("Archive written: %s\n", path);
+	return 0;
+}
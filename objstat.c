@@ -0,0 +1,120 @@
+/*
+ * objstat.c - Print statistics and bounds of OBJ files without loading them.
+ *
+ * Author: Philip R. Simonson
+ * Date  : 10/19/2026
+ *
+ *****************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+
+#include "unused.h"
+#include "stream.h"
+
+struct stats {
+	unsigned long v, vn, vt, tris, quads, ngons, mats, groups;
+	float min[3], max[3];
+};
+
+/* Grow bounds by a vertex.
+ */
+static int on_vertex(void *user, float x, float y, float z)
+{
+	struct stats *s = (struct stats*)user;
+	const float p[3] = {x, y, z};
+	int i;
+
+	for(i = 0; i < 3; i++) {
+		if(p[i] < s->min[i]) s->min[i] = p[i];
+		if(p[i] > s->max[i]) s->max[i] = p[i];
+	}
+	s->v++;
+	return 0;
+}
+/* Count a normal.
+ */
+static int on_normal(void *user, float UNUSED(x), float UNUSED(y),
+	float UNUSED(z))
+{
+	((struct stats*)user)->vn++;
+	return 0;
+}
+/* Count a texture coordinate.
+ */
+static int on_texcoord(void *user, float UNUSED(u), float UNUSED(v))
+{
+	((struct stats*)user)->vt++;
+	return 0;
+}
+/* Count a face by number of vertices.
+ */
+static int on_face(void *user, int count, const int *UNUSED(v),
+	const int *UNUSED(t), const int *UNUSED(n))
+{
+	struct stats *s = (struct stats*)user;
+
+	if(count == 3)
+		s->tris++;
+	else if(count == 4)
+		s->quads++;
+	else
+		s->ngons++;
+	return 0;
+}
+/* Count a material switch.
+ */
+static int on_usemtl(void *user, const char *UNUSED(name))
+{
+	((struct stats*)user)->mats++;
+	return 0;
+}
+/* Count an o or g record.
+ */
+static int on_group(void *user, const char *UNUSED(name))
+{
+	((struct stats*)user)->groups++;
+	return 0;
+}
+/* Entry point for OBJ statistics tool.
+ */
+int main(int argc, char **argv)
+{
+	int i, err = 0;
+
+	if(argc < 2) {
+		fprintf(stderr, "Usage: %s <file.obj> ...\n", argv[0]);
+		return 1;
+	}
+	for(i = 1; i < argc; i++) {
+		struct objstream cb = {0};
+		struct stats s = {0};
+
+		s.min[0] = s.min[1] = s.min[2] = FLT_MAX;
+		s.max[0] = s.max[1] = s.max[2] = -FLT_MAX;
+		cb.user = &s;
+		cb.vertex = on_vertex;
+		cb.normal = on_normal;
+		cb.texcoord = on_texcoord;
+		cb.face = on_face;
+		cb.usemtl = on_usemtl;
+		cb.group = on_group;
+		if(stream_object(argv[i], &cb) != 0) {
+			err = 1;
+			continue;
+		}
+		printf("%s\n"
+			" Vertices: %lu\n Normals: %lu\n UV Coords: %lu\n"
+			" Triangles: %lu\n Quads: %lu\n Polygons: %lu\n"
+			" Material Switches: %lu\n Groups: %lu\n",
+			argv[i], s.v, s.vn, s.vt, s.tris, s.quads, s.ngons,
+			s.mats, s.groups);
+		if(s.v > 0)
+			printf(" Bounds: (%f %f %f) - (%f %f %f)\n",
+				s.min[0], s.min[1], s.min[2],
+				s.max[0], s.max[1], s.max[2]);
+	}
+	return err;
+}
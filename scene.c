@@ -0,0 +1,554 @@
+/**
+ * @file scene.c
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Batch loading of objects and animations.
+ *
+ * @details Every object and animation frame is a job that moves through
+ * parse, material and texture tasks. Each worker owns a deque, pushes
+ * follow-up tasks to its own end and steals from the other end of the
+ * others' deques when it runs dry. Finished jobs are queued for the
+ * calling thread, which uploads them and reports progress.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bitmap.h"
+#include "object.h"
+#include "archive.h"
+#include "scene.h"
+#include "vector.h"
+
+#define MAX_THREADS 64
+
+enum { TASK_PARSE, TASK_MTL, TASK_TEXTURE };
+
+struct scene_job {
+	struct objfile *obj;
+	struct objarchive *ar;	/* frame source when the anim is packed */
+	char path[512];
+	char **usemtl;		/* names from parse_geometry() */
+	struct objfile **libs;	/* one per material library */
+	Bitmap **bmp;		/* decoded texture per material */
+	int lead;		/* archive job decoding shared textures, or -1 */
+	int frame, pending, err, uploaded;
+};
+
+struct scene_task {
+	struct scene_job *job;
+	int kind, index;
+};
+
+struct scene_worker {
+	struct scene *scene;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	struct scene_task *tasks;
+	size_t top, bottom, cap;	/* thieves take at top, owner at bottom */
+	int id;
+};
+
+struct scene {
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	struct scene_worker *workers;
+	struct scene_job **ready;
+	int nworkers, next, queued, quit;
+};
+
+static void run_task(struct scene *s, int id, struct scene_task *t);
+
+/* --------------------------- Helper Functions -------------------------- */
+
+/* Push task to the owner's end of a worker's deque.
+ */
+static int push_task(struct scene_worker *w, struct scene_task *t)
+{
+	int err = 0;
+
+	pthread_mutex_lock(&w->lock);
+	if(w->bottom - w->top == w->cap) {
+		size_t cap = w->cap > 0 ? w->cap*2 : 64, i;
+		struct scene_task *tasks;
+
+		if((tasks = malloc(cap*sizeof(struct scene_task))) != NULL) {
+			for(i = w->top; i < w->bottom; i++)
+				tasks[i & (cap-1)] = w->tasks[i & (w->cap-1)];
+			free(w->tasks);
+			w->tasks = tasks;
+			w->cap = cap;
+		} else {
+			err = -1;
+		}
+	}
+	if(!err) {
+		w->tasks[w->bottom & (w->cap-1)] = *t;
+		w->bottom++;
+	}
+	pthread_mutex_unlock(&w->lock);
+	return err;
+}
+/* Pop newest task from own deque, or steal the oldest from another.
+ * Returns non-zero if a task was found.
+ */
+static int take_task(struct scene *s, int id, struct scene_task *t)
+{
+	int i, found = 0;
+
+	for(i = 0; i < s->nworkers && !found; i++) {
+		struct scene_worker *w = &s->workers[(id+i) % s->nworkers];
+
+		pthread_mutex_lock(&w->lock);
+		if(w->bottom > w->top) {
+			if(i == 0)
+				*t = w->tasks[--w->bottom & (w->cap-1)];
+			else
+				*t = w->tasks[w->top++ & (w->cap-1)];
+			found = 1;
+		}
+		pthread_mutex_unlock(&w->lock);
+	}
+	if(found) {
+		pthread_mutex_lock(&s->lock);
+		s->queued--;
+		pthread_mutex_unlock(&s->lock);
+	}
+	return found;
+}
+/* Queue a task on worker id, or spread them when called from outside
+ * the pool (id < 0). Runs the task right away if it cannot be queued.
+ */
+static void schedule(struct scene *s, int id, struct scene_job *job,
+	int kind, int index)
+{
+	struct scene_task t;
+
+	t.job = job;
+	t.kind = kind;
+	t.index = index;
+	if(id < 0)
+		id = s->next++ % s->nworkers;
+	if(push_task(&s->workers[id], &t) != 0) {
+		run_task(s, id, &t);
+		return;
+	}
+	pthread_mutex_lock(&s->lock);
+	s->queued++;
+	pthread_cond_signal(&s->work);
+	pthread_mutex_unlock(&s->lock);
+}
+/* Count down one of a job's pending tasks, returns non-zero for the
+ * task that finished last.
+ */
+static int finish_pending(struct scene *s, struct scene_job *job)
+{
+	int last;
+
+	pthread_mutex_lock(&s->lock);
+	last = --job->pending == 0;
+	pthread_mutex_unlock(&s->lock);
+	return last;
+}
+/* Hand a finished job to the GL thread.
+ */
+static void job_ready(struct scene *s, struct scene_job *job)
+{
+	pthread_mutex_lock(&s->lock);
+	vector_push_back(s->ready, job);
+	pthread_cond_signal(&s->done);
+	pthread_mutex_unlock(&s->lock);
+}
+/* Schedule a decode for every material with a texture map.
+ */
+static void start_textures(struct scene *s, int id, struct scene_job *job)
+{
+	struct objfile *obj = job->obj;
+	size_t i;
+	int count = 0;
+
+	for(i = 0; i < obj->nmat; i++)
+		count += obj->mat[i].map[0] != 0 && !obj->mat[i].texture;
+	if(count == 0 || (job->bmp = calloc(obj->nmat,
+			sizeof(Bitmap*))) == NULL) {
+		/* upload_materials() loads any textures left. */
+		job_ready(s, job);
+		return;
+	}
+	job->pending = count;
+	for(i = 0; i < obj->nmat; i++)
+		if(obj->mat[i].map[0] != 0 && !obj->mat[i].texture)
+			schedule(s, id, job, TASK_TEXTURE, i);
+}
+/* Append materials of every library in order and resolve usemtl.
+ */
+static void finish_materials(struct scene_job *job)
+{
+	struct objfile *obj = job->obj;
+	size_t i, j;
+
+	for(i = 0; i < obj->nlib; i++) {
+		struct objfile *lib = job->libs[i];
+
+		if(lib == NULL)
+			continue;
+		for(j = 0; j < lib->nmat; j++)
+			vector_push_back(obj->mat, lib->mat[j]);
+		destroy_object(lib);
+	}
+	free(job->libs);
+	job->libs = NULL;
+	if(vector_size(obj->mat) > 0)
+		obj->ismat = 1;
+	if(resolve_materials(obj, job->usemtl) != 0)
+		job->err = 1;
+	free_anim_names(job->usemtl);
+	job->usemtl = NULL;
+}
+/* Parse geometry of a job, then schedule its material libraries.
+ */
+static void run_parse(struct scene *s, int id, struct scene_job *job)
+{
+	size_t i;
+
+	if(job->ar != NULL) {
+		if((job->obj = parse_archive_frame(job->ar, job->frame)) == NULL)
+			job->err = 1;
+	} else if((job->obj = init_object()) == NULL ||
+			parse_geometry(job->obj, job->path, &job->usemtl) != 0) {
+		job->err = 1;
+	}
+	if(job->err) {
+		job_ready(s, job);
+		return;
+	}
+	if(job->ar != NULL) {
+		/* Frames of an archive share textures, the lead decodes them. */
+		if(job->lead >= 0)
+			job_ready(s, job);
+		else
+			start_textures(s, id, job);
+		return;
+	}
+	if(job->obj->nlib == 0 || (job->libs = calloc(job->obj->nlib,
+			sizeof(struct objfile*))) == NULL) {
+		for(i = 0; i < job->obj->nlib; i++)
+			if(parse_material(job->obj, job->obj->lib[i]))
+				fprintf(stderr, "Warning: Could not load mtllib: %s\n",
+					job->obj->lib[i]);
+		if(resolve_materials(job->obj, job->usemtl) != 0)
+			job->err = 1;
+		free_anim_names(job->usemtl);
+		job->usemtl = NULL;
+		start_textures(s, id, job);
+		return;
+	}
+	job->pending = job->obj->nlib;
+	for(i = 0; i < job->obj->nlib; i++)
+		schedule(s, id, job, TASK_MTL, i);
+}
+/* Run one task, follow-up tasks go to worker id.
+ */
+static void run_task(struct scene *s, int id, struct scene_task *t)
+{
+	struct scene_job *job = t->job;
+
+	switch(t->kind) {
+	case TASK_PARSE:
+		run_parse(s, id, job);
+		break;
+	case TASK_MTL: {
+		const char *path = job->obj->lib[t->index];
+		struct objfile *lib;
+
+		if((lib = init_object()) != NULL && parse_material(lib, path))
+			fprintf(stderr, "Warning: Could not load mtllib: %s\n", path);
+		job->libs[t->index] = lib;
+		if(finish_pending(s, job)) {
+			finish_materials(job);
+			start_textures(s, id, job);
+		}
+		break;
+	}
+	case TASK_TEXTURE: {
+		Bitmap *bmp = load_bitmap(job->obj->mat[t->index].map);
+
+		/* The library's last error is shared between threads. */
+		if(bmp != NULL && bmp->data == NULL) {
+			destroy_bitmap(bmp);
+			bmp = NULL;
+		}
+		job->bmp[t->index] = bmp;
+		if(finish_pending(s, job))
+			job_ready(s, job);
+		break;
+	}
+	}
+}
+/* Worker thread, runs tasks until told to quit.
+ */
+static void *scene_thread(void *arg)
+{
+	struct scene_worker *w = (struct scene_worker*)arg;
+	struct scene *s = w->scene;
+	struct scene_task t;
+
+	for(;;) {
+		if(take_task(s, w->id, &t)) {
+			run_task(s, w->id, &t);
+			continue;
+		}
+		pthread_mutex_lock(&s->lock);
+		while(s->queued <= 0 && !s->quit)
+			pthread_cond_wait(&s->work, &s->lock);
+		if(s->quit && s->queued <= 0) {
+			pthread_mutex_unlock(&s->lock);
+			break;
+		}
+		pthread_mutex_unlock(&s->lock);
+	}
+	return NULL;
+}
+/* Upload textures decoded for a job and build its GL lists.
+ */
+static void upload_job(struct scene_job *job)
+{
+	size_t i;
+
+	if(job->bmp != NULL) {
+		for(i = 0; i < job->obj->nmat; i++) {
+			if(job->bmp[i] == NULL)
+				continue;
+			job->obj->mat[i].texture = share_texture(
+				job->obj->mat[i].map, job->bmp[i]);
+			destroy_bitmap(job->bmp[i]);
+		}
+		free(job->bmp);
+		job->bmp = NULL;
+	}
+	upload_object(job->obj);
+}
+/* Upload a ready job unless its lead job has not been uploaded yet,
+ * returns non-zero when the job is done.
+ */
+static int try_upload(struct scene_job *jobs, struct scene_job *job)
+{
+	if(job->lead >= 0 && !jobs[job->lead].uploaded)
+		return 0;
+	if(!job->err)
+		upload_job(job);
+	job->uploaded = 1;
+	return 1;
+}
+/* Add the jobs of one manifest entry to a vector of jobs, returns
+ * number of jobs added or -1 if the animation has no frames.
+ */
+static int add_jobs(struct scene_entry *e, struct scene_job **vec,
+	struct objarchive **ar)
+{
+	struct scene_job job, *jobs = *vec;
+	char path[512], **names;
+	size_t i, count;
+
+	memset(&job, 0, sizeof(job));
+	job.lead = -1;
+	*ar = NULL;
+	if(e->kind == SCENE_OBJECT) {
+		snprintf(job.path, sizeof(job.path), "%s", e->path);
+		vector_push_back(jobs, job);
+		*vec = jobs;
+		return 1;
+	}
+	snprintf(path, sizeof(path), "%s/%s%s", (e->path != NULL ? e->path : "."),
+		e->name, ARCHIVE_EXT);
+	if((*ar = open_archive(path)) != NULL) {
+		int lead = vector_size(jobs);
+
+		count = archive_frames(*ar);
+		for(i = 0; i < count; i++) {
+			job.ar = *ar;
+			job.lead = i > 0 ? lead : -1;
+			job.frame = (e->mode == SORTDEC ? count-i-1 : i);
+			snprintf(job.path, sizeof(job.path), "%s", path);
+			vector_push_back(jobs, job);
+		}
+		*vec = jobs;
+		return count;
+	}
+	if((names = get_anim_names(e->path, e->name, e->mode)) == NULL)
+		return -1;
+	count = vector_size(names);
+	for(i = 0; i < count; i++) {
+		snprintf(job.path, sizeof(job.path), "%s", names[i]);
+		vector_push_back(jobs, job);
+	}
+	free_anim_names(names);
+	*vec = jobs;
+	return count;
+}
+/* Move finished jobs into the manifest, returns non-zero if the entry
+ * failed.
+ */
+static int collect_jobs(struct scene_entry *e, struct scene_job *jobs,
+	int count)
+{
+	int i;
+
+	e->obj = NULL;
+	e->anim = NULL;
+	for(i = 0; i < count; i++) {
+		if(jobs[i].err) {
+			if(jobs[i].obj != NULL)
+				destroy_object(jobs[i].obj);
+			if(e->kind == SCENE_OBJECT)
+				fprintf(stderr, "Error: Cannot load object: %s\n",
+					jobs[i].path);
+			else
+				fprintf(stderr, "Frame [FAIL]: %d - %s\n", i,
+					jobs[i].path);
+			continue;
+		}
+		if(e->kind == SCENE_OBJECT)
+			e->obj = jobs[i].obj;
+		else
+			vector_push_back(e->anim, jobs[i].obj);
+	}
+	return e->kind == SCENE_OBJECT ? e->obj == NULL : e->anim == NULL;
+}
+
+/* --------------------------- Scene Functions --------------------------- */
+
+/* Load every entry of a manifest using threads workers (all processors
+ * if zero), progress is called on this thread after each upload.
+ * Returns number of entries that failed, or -1 on error.
+ */
+int load_scene(struct scene_entry *entries, int count, int threads,
+	void (*progress)(void *user, int percent, const char *path), void *user)
+{
+	struct scene_job *jobs = NULL, **ready, **wait = NULL;
+	struct objarchive **ar;
+	int *first, i, j, pass, done, total, started = 0, failed = 0;
+	struct scene s;
+
+	ar = calloc(count+1, sizeof(struct objarchive*));
+	first = calloc(count+1, sizeof(int));
+	if(ar == NULL || first == NULL) {
+		fprintf(stderr, "Error: Out of memory.\n");
+		free(ar);
+		free(first);
+		return -1;
+	}
+	for(i = 0; i < count; i++) {
+		first[i] = vector_size(jobs);
+		if(add_jobs(&entries[i], &jobs, &ar[i]) < 0)
+			fprintf(stderr, "Error: No frames for %s/%s.\n",
+				entries[i].path, entries[i].name);
+	}
+	total = first[count] = vector_size(jobs);
+
+	if(threads <= 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if(threads <= 0)
+		threads = 1;
+	if(threads > MAX_THREADS)
+		threads = MAX_THREADS;
+	memset(&s, 0, sizeof(s));
+	pthread_mutex_init(&s.lock, NULL);
+	pthread_cond_init(&s.work, NULL);
+	pthread_cond_init(&s.done, NULL);
+	if((s.workers = calloc(threads, sizeof(struct scene_worker))) == NULL) {
+		fprintf(stderr, "Error: Out of memory.\n");
+		failed = -1;
+		goto out;
+	}
+	for(i = 0; i < threads; i++) {
+		s.workers[i].scene = &s;
+		s.workers[i].id = i;
+		pthread_mutex_init(&s.workers[i].lock, NULL);
+	}
+	/* Deques without a thread are emptied by stealing. */
+	s.nworkers = threads;
+	for(started = 0; started < threads; started++)
+		if(pthread_create(&s.workers[started].thread, NULL, scene_thread,
+				&s.workers[started]) != 0)
+			break;
+	if(started == 0) {
+		fprintf(stderr, "Error: Cannot start scene threads.\n");
+		failed = -1;
+		goto out;
+	}
+	for(i = 0; i < total; i++)
+		schedule(&s, -1, &jobs[i], TASK_PARSE, 0);
+
+	/* Upload jobs as they finish, GL stays on this thread. */
+	pthread_mutex_lock(&s.lock);
+	for(done = 0; done < total; ) {
+		while(vector_size(s.ready) == 0)
+			pthread_cond_wait(&s.done, &s.lock);
+		ready = s.ready;
+		s.ready = NULL;
+		pthread_mutex_unlock(&s.lock);
+		for(j = 0; j < (int)vector_size(wait); j++)
+			vector_push_back(ready, wait[j]);
+		vector_free(wait);
+		wait = NULL;
+		/* Leads are never held back, so a second pass uploads the
+		 * frames waiting on a lead from this batch.
+		 */
+		for(pass = 0; pass < 2; pass++) {
+			for(j = 0; j < (int)vector_size(ready); j++) {
+				if(!try_upload(jobs, ready[j])) {
+					vector_push_back(wait, ready[j]);
+					continue;
+				}
+				done++;
+				if(progress != NULL)
+					progress(user, done*100/total, ready[j]->path);
+			}
+			vector_free(ready);
+			ready = wait;
+			wait = NULL;
+		}
+		wait = ready;
+		pthread_mutex_lock(&s.lock);
+	}
+	s.quit = 1;
+	pthread_cond_broadcast(&s.work);
+	pthread_mutex_unlock(&s.lock);
+
+	for(i = 0; i < count; i++)
+		failed += collect_jobs(&entries[i], &jobs[first[i]],
+			first[i+1]-first[i]);
+
+out:
+	/* Workers still steal from every deque until they are joined. */
+	for(i = 0; i < started; i++)
+		pthread_join(s.workers[i].thread, NULL);
+	for(i = 0; i < s.nworkers; i++) {
+		pthread_mutex_destroy(&s.workers[i].lock);
+		free(s.workers[i].tasks);
+	}
+	if(failed < 0)
+		for(i = 0; i < total; i++)
+			if(jobs[i].obj != NULL)
+				destroy_object(jobs[i].obj);
+	free(s.workers);
+	vector_free(s.ready);
+	vector_free(wait);
+	pthread_cond_destroy(&s.done);
+	pthread_cond_destroy(&s.work);
+	pthread_mutex_destroy(&s.lock);
+	for(i = 0; i < count; i++)
+		close_archive(ar[i]);
+	vector_free(jobs);
+	free(ar);
+	free(first);
+	return failed;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file scene.h
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Batch loading of objects and animations.
+ *
+ * @details load_scene() takes a manifest of objects and animations and
+ * runs every OBJ parse, MTL parse and texture decode as a task on one
+ * work-stealing thread pool. An object's material libraries are parsed
+ * once its geometry names them, usemtl is resolved after all of them
+ * are loaded, and its textures are decoded after that. GL uploads are
+ * done on the calling thread, which must own the GL context.
+ */
+
+#ifndef PRS_SCENE_H
+#define PRS_SCENE_H
+
+#include "export.h"
+#include "object.h"
+
+enum { SCENE_OBJECT, SCENE_ANIM };
+
+struct scene_entry {
+	int kind;
+	const char *path;	/* object file, or animation directory */
+	const char *name;	/* animation name */
+	int mode;		/* SORTASC or SORTDEC for animations */
+	struct objfile *obj;	/* loaded object */
+	struct objfile **anim;	/* loaded animation frames */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+PRS_EXPORT int load_scene(struct scene_entry *entries, int count, int threads,
+	void (*progress)(void *user, int percent, const char *path), void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,287 @@
+/**
+ * @file source.c
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Transparent decompression of input files.
+ *
+ * @details Compressed files are detected by their magic bytes. The
+ * decoder thread writes into a pipe which the parser reads either by
+ * descriptor or through its /dev/fd path.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "source.h"
+
+enum { SOURCE_PLAIN, SOURCE_GZIP, SOURCE_ZSTD };
+
+struct objsource {
+	pthread_t thread;
+	char path[512];
+	int fd, in, out;
+	int kind, err;
+};
+
+/* --------------------------- Helper Functions -------------------------- */
+
+/* Write whole buffer to pipe, returns -1 if the reader went away.
+ */
+static int write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = (const char*)buf;
+
+	while(len > 0) {
+		ssize_t n = write(fd, p, len);
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+/* Decode gzip stream into pipe, returns non-zero on corrupt data.
+ */
+static int decode_gzip(struct objsource *src)
+{
+	char *buf;
+	gzFile gz;
+	int n, err = 0;
+
+	if((buf = malloc(SOURCE_BUFSIZE)) == NULL)
+		return 1;
+	if((gz = gzdopen(src->in, "rb")) == NULL) {
+		free(buf);
+		return 1;
+	}
+	src->in = -1;
+	gzbuffer(gz, SOURCE_BUFSIZE);
+	while((n = gzread(gz, buf, SOURCE_BUFSIZE)) > 0)
+		if(write_all(src->out, buf, n) < 0)
+			break;
+	if(n <= 0) {
+		int zerr;
+		gzerror(gz, &zerr);
+		err = (n < 0 || (zerr != Z_OK && zerr != Z_STREAM_END));
+	}
+	gzclose(gz);
+	free(buf);
+	return err;
+}
+#ifdef HAVE_ZSTD
+/* Decode zstd stream into pipe, returns non-zero on corrupt data.
+ */
+static int decode_zstd(struct objsource *src)
+{
+	size_t insize = ZSTD_DStreamInSize(), outsize = ZSTD_DStreamOutSize();
+	void *inbuf = malloc(insize), *outbuf = malloc(outsize);
+	ZSTD_DStream *ds = ZSTD_createDStream();
+	int err = 0, done = 0;
+	size_t last = 0;
+	ssize_t n = 0;
+
+	if(inbuf == NULL || outbuf == NULL || ds == NULL) {
+		err = 1;
+		goto out;
+	}
+	ZSTD_initDStream(ds);
+	while(!err && !done && (n = read(src->in, inbuf, insize)) != 0) {
+		ZSTD_inBuffer in;
+		int full = 0;
+
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			err = 1;
+			break;
+		}
+		in.src = inbuf;
+		in.size = n;
+		in.pos = 0;
+		/* A full output buffer may hold back more data, flush it. */
+		while(in.pos < in.size || full) {
+			ZSTD_outBuffer out;
+
+			out.dst = outbuf;
+			out.size = outsize;
+			out.pos = 0;
+			last = ZSTD_decompressStream(ds, &out, &in);
+			if(ZSTD_isError(last)) {
+				err = 1;
+				break;
+			}
+			full = out.pos == out.size;
+			if(write_all(src->out, outbuf, out.pos) < 0) {
+				done = 1;
+				break;
+			}
+		}
+	}
+	/* Input ended in the middle of a frame. */
+	if(!err && !done && last != 0)
+		err = 1;
+
+out:
+	ZSTD_freeDStream(ds);
+	free(inbuf);
+	free(outbuf);
+	return err;
+}
+#endif
+/* Decoder thread, feeds the pipe until input ends.
+ */
+static void *decode_thread(void *arg)
+{
+	struct objsource *src = (struct objsource*)arg;
+	struct timespec zero = {0, 0};
+	sigset_t set;
+
+	/* Reader may stop early, get EPIPE instead of being killed. */
+	sigemptyset(&set);
+	sigaddset(&set, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+	if(src->kind == SOURCE_GZIP)
+		src->err = decode_gzip(src);
+#ifdef HAVE_ZSTD
+	else
+		src->err = decode_zstd(src);
+#endif
+	close(src->out);
+	sigtimedwait(&set, NULL, &zero);
+	return NULL;
+}
+/* Detect compression from magic bytes.
+ */
+static int detect_kind(int fd)
+{
+	unsigned char magic[4];
+
+	if(pread(fd, magic, 4, 0) != 4)
+		return SOURCE_PLAIN;
+	if(magic[0] == 0x1f && magic[1] == 0x8b)
+		return SOURCE_GZIP;
+	if(magic[0] == 0x28 && magic[1] == 0xb5 &&
+			magic[2] == 0x2f && magic[3] == 0xfd)
+		return SOURCE_ZSTD;
+	return SOURCE_PLAIN;
+}
+
+/* -------------------------- Source Functions --------------------------- */
+
+/* Open file for reading, decompressing it on a thread when needed.
+ */
+struct objsource *open_source(const char *filename)
+{
+	struct objsource *src;
+	int fd, p[2];
+
+	if((fd = open(filename, O_RDONLY)) < 0) {
+		fprintf(stderr, "Error: %s: %s\n", filename, strerror(errno));
+		return NULL;
+	}
+	src = (struct objsource*)malloc(sizeof(struct objsource));
+	if(!src) {
+		fprintf(stderr, "Error: Cannot open source, out of memory.\n");
+		close(fd);
+		return NULL;
+	}
+	src->err = 0;
+	src->in = src->out = -1;
+	src->kind = detect_kind(fd);
+	if(src->kind == SOURCE_PLAIN) {
+		src->fd = fd;
+		snprintf(src->path, sizeof(src->path), "%s", filename);
+		return src;
+	}
+#ifndef HAVE_ZSTD
+	if(src->kind == SOURCE_ZSTD) {
+		fprintf(stderr, "Error: %s: Built without zstd support.\n",
+			filename);
+		close(fd);
+		free(src);
+		return NULL;
+	}
+#endif
+	if(pipe(p) < 0) {
+		fprintf(stderr, "Error: %s\n", strerror(errno));
+		close(fd);
+		free(src);
+		return NULL;
+	}
+	fcntl(p[1], F_SETPIPE_SZ, 1024*1024);
+	src->in = fd;
+	src->fd = p[0];
+	src->out = p[1];
+	snprintf(src->path, sizeof(src->path), "/dev/fd/%d", p[0]);
+	if(pthread_create(&src->thread, NULL, decode_thread, src) != 0) {
+		fprintf(stderr, "Error: Cannot start decoder thread.\n");
+		close(p[0]);
+		close(p[1]);
+		close(fd);
+		free(src);
+		return NULL;
+	}
+	return src;
+}
+/* Get descriptor to read decompressed data from.
+ */
+int source_fd(const struct objsource *src)
+{
+	return src->fd;
+}
+/* Get path that opens decompressed data, for file_t readers.
+ */
+const char *source_path(const struct objsource *src)
+{
+	return src->path;
+}
+/* Close source and stop its decoder, returns non-zero if data was corrupt.
+ */
+int close_source(struct objsource *src)
+{
+	int err;
+
+	close(src->fd);
+	if(src->kind != SOURCE_PLAIN) {
+		pthread_join(src->thread, NULL);
+		if(src->in >= 0)
+			close(src->in);
+	}
+	err = src->err;
+	free(src);
+	return err;
+}
+/* Find filename, or a compressed copy of it with .gz or .zst appended.
+ * Returns 0 when found, path always holds a name to try.
+ */
+int find_source(const char *filename, char *path, size_t size)
+{
+	static const char *ext[] = {"", ".gz", ".zst"};
+	size_t i;
+
+	for(i = 0; i < sizeof(ext)/sizeof(ext[0]); i++) {
+		snprintf(path, size, "%s%s", filename, ext[i]);
+		if(access(path, R_OK) == 0)
+			return 0;
+	}
+	snprintf(path, size, "%s", filename);
+	return 1;
+}
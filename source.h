@@ -0,0 +1,38 @@
+/**
+ * @file source.h
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Transparent decompression of input files.
+ *
+ * @details Opens a file for reading, and if it is gzip or zstd
+ * compressed starts a thread that decodes it into a pipe, so parsing
+ * runs in parallel with decompression. Plain files are read directly.
+ * zstd support needs the library at build time (make ZSTD=1).
+ */
+
+#ifndef PRS_SOURCE_H
+#define PRS_SOURCE_H
+
+#include <stddef.h>
+
+#include "export.h"
+
+#define SOURCE_BUFSIZE 65536
+
+struct objsource;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+PRS_EXPORT struct objsource *open_source(const char *filename);
+PRS_EXPORT int source_fd(const struct objsource *src);
+PRS_EXPORT const char *source_path(const struct objsource *src);
+PRS_EXPORT int close_source(struct objsource *src);
+PRS_EXPORT int find_source(const char *filename, char *path, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
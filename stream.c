@@ -0,0 +1,291 @@
+/**
+ * @file stream.c
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Callback based streaming OBJ parser.
+ *
+ * @details Memory use is one read buffer and one face, no matter how
+ * large the file is. The buffer only grows past STREAM_BUFSIZE for a
+ * longer line.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "stream.h"
+#include "source.h"
+
+struct reader {
+	char *buf;
+	size_t size, start, end;
+	struct objsource *src;
+	int fd, eof;
+};
+
+struct counts {
+	int v, vn, vt;
+};
+
+struct facebuf {
+	int *v, *t, *n;
+	int cap;
+};
+
+/* --------------------------- Helper Functions -------------------------- */
+
+/* Read next line into reader buffer, returns NULL at end of file or
+ * on error. The buffer is doubled when a line does not fit.
+ */
+static char *next_line(struct reader *r)
+{
+	for(;;) {
+		char *nl = memchr(r->buf+r->start, '\n', r->end-r->start);
+		char *line = r->buf+r->start;
+		ssize_t len;
+
+		if(nl != NULL) {
+			*nl = 0;
+			r->start = nl-r->buf+1;
+			return line;
+		}
+		if(r->eof) {
+			if(r->start == r->end)
+				return NULL;
+			r->buf[r->end] = 0;
+			r->start = r->end;
+			return line;
+		}
+		if(r->start > 0) {
+			memmove(r->buf, r->buf+r->start, r->end-r->start);
+			r->end -= r->start;
+			r->start = 0;
+		} else if(r->end == r->size) {
+			char *buf = (char*)realloc(r->buf, r->size*2+1);
+
+			if(buf == NULL)
+				return NULL;
+			r->buf = buf;
+			r->size *= 2;
+		}
+		len = read(r->fd, r->buf+r->end, r->size-r->end);
+		if(len < 0) {
+			if(errno == EINTR)
+				continue;
+			return NULL;
+		}
+		if(len == 0)
+			r->eof = 1;
+		r->end += len;
+	}
+}
+/* Skip spaces and tabs.
+ */
+static char *skip_space(char *s)
+{
+	while(*s == ' ' || *s == '\t' || *s == '\r')
+		s++;
+	return s;
+}
+/* Parse up to count floats, missing ones are left at zero.
+ */
+static void parse_floats(char *s, float *out, int count)
+{
+	int i;
+
+	for(i = 0; i < count; i++) {
+		char *end;
+		out[i] = strtof(s, &end);
+		if(end == s) {
+			for(; i < count; i++)
+				out[i] = 0.0f;
+			break;
+		}
+		s = end;
+	}
+}
+/* Resolve a relative or absolute index to a 1-based index.
+ */
+static int resolve(long idx, int count)
+{
+	if(idx < 0)
+		return count + idx + 1;
+	return idx;
+}
+/* Make room for cap face vertices, returns non-zero when out of memory.
+ */
+static int grow_face(struct facebuf *fb, int cap)
+{
+	int *v, *t, *n;
+
+	if((v = realloc(fb->v, cap*sizeof(int))) != NULL)
+		fb->v = v;
+	if((t = realloc(fb->t, cap*sizeof(int))) != NULL)
+		fb->t = t;
+	if((n = realloc(fb->n, cap*sizeof(int))) != NULL)
+		fb->n = n;
+	if(v == NULL || t == NULL || n == NULL)
+		return 1;
+	fb->cap = cap;
+	return 0;
+}
+/* Parse a face record, returns number of vertices read or -1 when out
+ * of memory.
+ */
+static int parse_face(char *s, const struct counts *c, struct facebuf *fb)
+{
+	int count = 0;
+
+	for(;;) {
+		char *end;
+		long idx;
+
+		s = skip_space(s);
+		if(*s == 0)
+			break;
+		idx = strtol(s, &end, 10);
+		if(end == s)
+			break;
+		if(count == fb->cap && grow_face(fb, fb->cap*2))
+			return -1;
+		fb->v[count] = resolve(idx, c->v);
+		fb->t[count] = fb->n[count] = 0;
+		s = end;
+		if(*s == '/') {
+			idx = strtol(++s, &end, 10);
+			if(end != s)
+				fb->t[count] = resolve(idx, c->vt);
+			s = end;
+			if(*s == '/') {
+				idx = strtol(++s, &end, 10);
+				if(end != s)
+					fb->n[count] = resolve(idx, c->vn);
+				s = end;
+			}
+		}
+		while(*s != 0 && *s != ' ' && *s != '\t')
+			s++;
+		count++;
+	}
+	return count;
+}
+/* Cut trailing whitespace from a name.
+ */
+static char *trim_name(char *s)
+{
+	char *end;
+
+	s = skip_space(s);
+	end = s + strlen(s);
+	while(end > s && (end[-1] == ' ' || end[-1] == '\t' ||
+			end[-1] == '\r'))
+		*--end = 0;
+	return s;
+}
+
+/* -------------------------- Stream Functions --------------------------- */
+
+/* Parse file and call back for each record.
+ * Returns 0 when done, a callback's non-zero value when it stopped the
+ * parse, or 1 when the file could not be read.
+ */
+int stream_object(const char *filename, const struct objstream *cb)
+{
+	struct facebuf fb;
+	struct counts c;
+	struct reader *r;
+	char *line;
+	int ret = 0;
+
+	r = (struct reader*)malloc(sizeof(struct reader));
+	if(!r) {
+		fprintf(stderr, "Error: Cannot create reader, out of memory.\n");
+		return 1;
+	}
+	memset(&fb, 0, sizeof(fb));
+	r->size = STREAM_BUFSIZE;
+	if((r->buf = (char*)malloc(r->size+1)) == NULL ||
+			grow_face(&fb, STREAM_MAXVERTS)) {
+		fprintf(stderr, "Error: Cannot create reader, out of memory.\n");
+		ret = 1;
+		goto out;
+	}
+	if((r->src = open_source(filename)) == NULL) {
+		ret = 1;
+		goto out;
+	}
+	r->fd = source_fd(r->src);
+	posix_fadvise(r->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	r->start = r->end = 0;
+	r->eof = 0;
+	memset(&c, 0, sizeof(c));
+
+	while(ret == 0 && (line = next_line(r)) != NULL) {
+		float f[3];
+
+		line = skip_space(line);
+		if(line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+			c.v++;
+			if(cb->vertex) {
+				parse_floats(line+2, f, 3);
+				ret = cb->vertex(cb->user, f[0], f[1], f[2]);
+			}
+		} else if(!strncmp(line, "vn", 2) &&
+				(line[2] == ' ' || line[2] == '\t')) {
+			c.vn++;
+			if(cb->normal) {
+				parse_floats(line+3, f, 3);
+				ret = cb->normal(cb->user, f[0], f[1], f[2]);
+			}
+		} else if(!strncmp(line, "vt", 2) &&
+				(line[2] == ' ' || line[2] == '\t')) {
+			c.vt++;
+			if(cb->texcoord) {
+				parse_floats(line+3, f, 2);
+				ret = cb->texcoord(cb->user, f[0], f[1]);
+			}
+		} else if(line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+			if(cb->face) {
+				int count = parse_face(line+2, &c, &fb);
+				if(count < 0) {
+					fprintf(stderr, "Error: %s: Out of memory.\n",
+						filename);
+					ret = 1;
+				} else if(count > 0) {
+					ret = cb->face(cb->user, count, fb.v, fb.t, fb.n);
+				}
+			}
+		} else if(!strncmp(line, "usemtl", 6)) {
+			if(cb->usemtl)
+				ret = cb->usemtl(cb->user, trim_name(line+6));
+		} else if(!strncmp(line, "mtllib", 6)) {
+			if(cb->mtllib)
+				ret = cb->mtllib(cb->user, trim_name(line+6));
+		} else if((line[0] == 'o' || line[0] == 'g') &&
+				(line[1] == ' ' || line[1] == '\t' || line[1] == 0)) {
+			if(cb->group)
+				ret = cb->group(cb->user, trim_name(line+1));
+		}
+	}
+	if(ret == 0 && !r->eof) {
+		fprintf(stderr, "Error: %s: %s\n", filename, strerror(errno));
+		ret = 1;
+	}
+	if(close_source(r->src) && ret == 0) {
+		fprintf(stderr, "Error: %s: Corrupt compressed data.\n", filename);
+		ret = 1;
+	}
+out:
+	free(fb.v);
+	free(fb.t);
+	free(fb.n);
+	free(r->buf);
+	free(r);
+	return ret;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file stream.h
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Callback based streaming OBJ parser.
+ *
+ * @details Reads an OBJ file line by line through a fixed size buffer
+ * and hands every record to a callback instead of building an objfile,
+ * so files larger than memory can be processed. Any callback may be
+ * NULL, and returning non-zero from a callback stops the parse.
+ *
+ * Face indexes are resolved to 1-based positions, negative (relative)
+ * indexes included; 0 means the element was not given. Face buffers
+ * start at STREAM_MAXVERTS vertices and grow for larger faces. o and g
+ * records are both handed to the group callback.
+ */
+
+#ifndef PRS_STREAM_H
+#define PRS_STREAM_H
+
+#include "export.h"
+
+#define STREAM_BUFSIZE 65536
+#define STREAM_MAXVERTS 256
+
+struct objstream {
+	void *user;
+	int (*vertex)(void *user, float x, float y, float z);
+	int (*normal)(void *user, float x, float y, float z);
+	int (*texcoord)(void *user, float u, float v);
+	int (*face)(void *user, int count, const int *v, const int *t,
+		const int *n);
+	int (*usemtl)(void *user, const char *name);
+	int (*mtllib)(void *user, const char *name);
+	int (*group)(void *user, const char *name);
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+PRS_EXPORT int stream_object(const char *filename, const struct objstream *cb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,508 @@
+/**
+ * @file watch.c
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Hot reload of objects when their files change.
+ *
+ * @details A background thread waits on inotify for writes to the
+ * directories holding watched files. Parsing happens on that thread,
+ * everything touching OpenGL is deferred to poll_watch().
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+
+#include "bitmap.h"
+#include "object.h"
+#include "watch.h"
+#include "vector.h"
+
+enum { WATCH_OBJ, WATCH_MTL, WATCH_BMP };
+
+struct watch_entry {
+	struct objfile *obj;
+	char path[512];
+	char name[256];
+	int kind;
+	int wd;
+};
+
+struct watch_reload {
+	struct objfile *obj;
+	struct objfile *parsed;
+	Bitmap *bmp;
+	char path[512];
+	int kind;
+};
+
+struct objwatch {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	struct watch_entry *entries;
+	struct watch_reload *pending;
+	int fd, quit[2];
+};
+
+/* --------------------------- Helper Functions -------------------------- */
+
+/* Add a watch entry for a file, lock must be held.
+ */
+static int add_entry(struct objwatch *w, struct objfile *obj,
+	const char *path, int kind)
+{
+	struct watch_entry e;
+	char dir[512];
+	const char *sep;
+
+	memset(&e, 0, sizeof(e));
+	snprintf(e.path, sizeof(e.path), "%s", path);
+	if((sep = strrchr(path, '/')) != NULL) {
+		snprintf(dir, sizeof(dir), "%.*s", (int)(sep-path), path);
+		snprintf(e.name, sizeof(e.name), "%s", sep+1);
+	} else {
+		strcpy(dir, ".");
+		snprintf(e.name, sizeof(e.name), "%s", path);
+	}
+	e.wd = inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE|IN_MOVED_TO);
+	if(e.wd < 0) {
+		fprintf(stderr, "Error: Cannot watch %s: %s\n", dir,
+			strerror(errno));
+		return 1;
+	}
+	e.obj = obj;
+	e.kind = kind;
+	vector_push_back(w->entries, e);
+	return 0;
+}
+/* Remove entries of an object, all kinds when kind is negative.
+ */
+static void remove_entries(struct objwatch *w, struct objfile *obj, int kind)
+{
+	struct watch_entry *entries = NULL;
+	size_t i;
+
+	for(i = 0; i < vector_size(w->entries); i++)
+		if(w->entries[i].obj != obj ||
+				(kind >= 0 && w->entries[i].kind != kind))
+			vector_push_back(entries, w->entries[i]);
+	vector_free(w->entries);
+	w->entries = entries;
+}
+/* Add entries for material libraries and textures of an object.
+ */
+static void add_material_entries(struct objwatch *w, struct objfile *obj)
+{
+	size_t i, j;
+
+	for(i = 0; i < obj->nlib; i++)
+		add_entry(w, obj, obj->lib[i], WATCH_MTL);
+	for(i = 0; i < obj->nmat; i++) {
+		if(obj->mat[i].map[0] == 0)
+			continue;
+		for(j = 0; j < i; j++)
+			if(!strcmp(obj->mat[j].map, obj->mat[i].map))
+				break;
+		if(j == i)
+			add_entry(w, obj, obj->mat[i].map, WATCH_BMP);
+	}
+}
+/* Find path of an object's OBJ file, lock must be held.
+ */
+static const char *object_path(struct objwatch *w, struct objfile *obj)
+{
+	size_t i;
+
+	for(i = 0; i < vector_size(w->entries); i++)
+		if(w->entries[i].obj == obj && w->entries[i].kind == WATCH_OBJ)
+			return w->entries[i].path;
+	return NULL;
+}
+/* Check two material arrays have the same names in the same order.
+ */
+static int same_materials(const struct material *a, size_t na,
+	const struct material *b, size_t nb)
+{
+	size_t i;
+
+	if(na != nb)
+		return 0;
+	for(i = 0; i < na; i++)
+		if(strcmp(a[i].name, b[i].name) != 0)
+			return 0;
+	return 1;
+}
+/* Parse every material library of an object without holding the lock,
+ * switches to a whole object reload if face material indexes changed.
+ */
+static int reload_materials(struct objwatch *w, struct watch_reload *r)
+{
+	struct material *mat = NULL;
+	char path[512], **libs = NULL;
+	size_t i, nmat;
+	int err = 0;
+
+	pthread_mutex_lock(&w->lock);
+	if(object_path(w, r->obj) == NULL) {
+		pthread_mutex_unlock(&w->lock);
+		return 1;
+	}
+	snprintf(path, sizeof(path), "%s", object_path(w, r->obj));
+	for(i = 0; i < r->obj->nlib; i++)
+		vector_push_back(libs, strdup(r->obj->lib[i]));
+	for(i = 0; i < r->obj->nmat; i++)
+		vector_push_back(mat, r->obj->mat[i]);
+	nmat = r->obj->nmat;
+	pthread_mutex_unlock(&w->lock);
+
+	/* Reload every library so material indexes stay put. */
+	for(i = 0; i < vector_size(libs) && !err; i++)
+		err = libs[i] == NULL || parse_material(r->parsed, libs[i]);
+	if(!err && !same_materials(r->parsed->mat, r->parsed->nmat,
+			mat, nmat)) {
+		/* Materials added, removed or reordered, reload the faces. */
+		r->kind = WATCH_OBJ;
+		snprintf(r->path, sizeof(r->path), "%s", path);
+		destroy_object(r->parsed);
+		if((r->parsed = init_object()) == NULL)
+			err = 1;
+		else
+			err = parse_object(r->parsed, r->path);
+	}
+	for(i = 0; i < vector_size(libs); i++)
+		free(libs[i]);
+	vector_free(libs);
+	vector_free(mat);
+	return err;
+}
+/* Free data held by a reload that was never applied.
+ */
+static void free_reload(struct watch_reload *r)
+{
+	if(r->parsed != NULL)
+		destroy_object(r->parsed);
+	if(r->bmp != NULL)
+		destroy_bitmap(r->bmp);
+}
+/* Queue a parsed reload, replacing an older one for the same file.
+ */
+static void queue_reload(struct objwatch *w, struct watch_reload *r)
+{
+	size_t i;
+
+	pthread_mutex_lock(&w->lock);
+	if(object_path(w, r->obj) == NULL || (r->kind == WATCH_MTL &&
+			!same_materials(r->obj->mat, r->obj->nmat,
+			r->parsed->mat, r->parsed->nmat))) {
+		/* Object was unwatched or reloaded while parsing. */
+		pthread_mutex_unlock(&w->lock);
+		free_reload(r);
+		return;
+	}
+	for(i = 0; i < vector_size(w->pending); i++) {
+		struct watch_reload *p = &w->pending[i];
+		if(p->obj == r->obj && p->kind == r->kind &&
+				!strcmp(p->path, r->path)) {
+			free_reload(p);
+			*p = *r;
+			pthread_mutex_unlock(&w->lock);
+			return;
+		}
+	}
+	vector_push_back(w->pending, *r);
+	pthread_mutex_unlock(&w->lock);
+}
+/* Parse the changed file of an entry, runs on the watch thread.
+ */
+static void reload_entry(struct objwatch *w, const struct watch_entry *e)
+{
+	struct watch_reload r;
+
+	memset(&r, 0, sizeof(r));
+	r.obj = e->obj;
+	r.kind = e->kind;
+	snprintf(r.path, sizeof(r.path), "%s", e->path);
+	if(e->kind == WATCH_BMP) {
+		r.bmp = load_bitmap(e->path);
+		if(r.bmp == NULL || get_last_error_bitmap() != BMP_NO_ERROR) {
+			fprintf(stderr, "Warning: Cannot reload %s\n", e->path);
+			if(r.bmp != NULL)
+				destroy_bitmap(r.bmp);
+			return;
+		}
+	} else {
+		int err;
+
+		if((r.parsed = init_object()) == NULL)
+			return;
+		if(e->kind == WATCH_OBJ)
+			err = parse_object(r.parsed, e->path);
+		else
+			err = reload_materials(w, &r);
+		if(err) {
+			fprintf(stderr, "Warning: Cannot reload %s\n", e->path);
+			if(r.parsed != NULL)
+				destroy_object(r.parsed);
+			return;
+		}
+	}
+	queue_reload(w, &r);
+}
+/* Watch thread, reads inotify events until told to quit.
+ */
+static void *watch_thread(void *arg)
+{
+	struct objwatch *w = (struct objwatch*)arg;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	for(;;) {
+		struct pollfd fds[2];
+		ssize_t len;
+		char *p;
+
+		fds[0].fd = w->fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = w->quit[0];
+		fds[1].events = POLLIN;
+		if(poll(fds, 2, -1) < 0) {
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+		if(fds[1].revents)
+			break;
+		if((len = read(w->fd, buf, sizeof(buf))) <= 0)
+			continue;
+		for(p = buf; p < buf+len; ) {
+			const struct inotify_event *ev =
+				(const struct inotify_event*)p;
+			struct watch_entry *hits = NULL;
+			size_t i;
+
+			p += sizeof(struct inotify_event) + ev->len;
+			if(ev->len == 0)
+				continue;
+			pthread_mutex_lock(&w->lock);
+			for(i = 0; i < vector_size(w->entries); i++)
+				if(w->entries[i].wd == ev->wd &&
+						!strcmp(w->entries[i].name, ev->name))
+					vector_push_back(hits, w->entries[i]);
+			pthread_mutex_unlock(&w->lock);
+			for(i = 0; i < vector_size(hits); i++)
+				reload_entry(w, &hits[i]);
+			vector_free(hits);
+		}
+	}
+	return NULL;
+}
+/* Swap a freshly parsed object into the live one.
+ */
+static void apply_object(struct objwatch *w, struct objfile *obj,
+	struct objfile *parsed)
+{
+	struct objfile tmp;
+
+	upload_object(parsed);
+	pthread_mutex_lock(&w->lock);
+	tmp = *obj;
+	*obj = *parsed;
+	*parsed = tmp;
+	obj->refs = tmp.refs;
+	parsed->refs = 1;
+	pthread_mutex_unlock(&w->lock);
+	destroy_object(parsed);
+	pthread_mutex_lock(&w->lock);
+	remove_entries(w, obj, WATCH_MTL);
+	remove_entries(w, obj, WATCH_BMP);
+	add_material_entries(w, obj);
+	pthread_mutex_unlock(&w->lock);
+}
+/* Swap freshly parsed materials into the live object.
+ */
+static void apply_materials(struct objwatch *w, struct objfile *obj,
+	struct objfile *parsed)
+{
+	struct material *mat;
+	size_t i;
+
+	if(!same_materials(obj->mat, obj->nmat, parsed->mat, parsed->nmat)) {
+		/* Object changed since the parse, its reload is queued. */
+		destroy_object(parsed);
+		return;
+	}
+	for(i = 0; i < obj->nmat; i++) {
+		if(!strcmp(parsed->mat[i].map, obj->mat[i].map)) {
+			parsed->mat[i].texture = obj->mat[i].texture;
+			obj->mat[i].texture = 0;
+		}
+	}
+	pthread_mutex_lock(&w->lock);
+	mat = obj->mat;
+	obj->mat = parsed->mat;
+	parsed->mat = mat;
+	pthread_mutex_unlock(&w->lock);
+	upload_materials(obj);
+	destroy_object(parsed);
+	pthread_mutex_lock(&w->lock);
+	remove_entries(w, obj, WATCH_BMP);
+	add_material_entries(w, obj);
+	pthread_mutex_unlock(&w->lock);
+}
+/* Upload a freshly decoded texture into the live object.
+ */
+static void apply_texture(struct objfile *obj, const char *path, Bitmap *bmp)
+{
+	int rebuild = 0;
+	size_t i;
+
+	for(i = 0; i < obj->nmat; i++) {
+		unsigned int tex;
+
+		if(strcmp(obj->mat[i].map, path) != 0)
+			continue;
+		if((tex = upload_texture(obj->mat[i].texture, bmp)) == 0)
+			continue;
+		if(!obj->mat[i].texture)
+			rebuild = 1;
+		obj->mat[i].texture = tex;
+	}
+	if(rebuild)
+		upload_materials(obj);	/* lists of untextured materials */
+	destroy_bitmap(bmp);
+}
+
+/* --------------------------- Watch Functions --------------------------- */
+
+/* Create watcher and start its thread.
+ */
+struct objwatch *init_watch(void)
+{
+	struct objwatch *w;
+
+	w = (struct objwatch*)malloc(sizeof(struct objwatch));
+	if(!w) {
+		fprintf(stderr, "Error: Cannot create watch, out of memory.\n");
+		return NULL;
+	}
+	w->entries = NULL;
+	w->pending = NULL;
+	if((w->fd = inotify_init()) < 0) {
+		fprintf(stderr, "Error: %s\n", strerror(errno));
+		free(w);
+		return NULL;
+	}
+	if(pipe(w->quit) < 0) {
+		fprintf(stderr, "Error: %s\n", strerror(errno));
+		close(w->fd);
+		free(w);
+		return NULL;
+	}
+	pthread_mutex_init(&w->lock, NULL);
+	if(pthread_create(&w->thread, NULL, watch_thread, w) != 0) {
+		fprintf(stderr, "Error: Cannot start watch thread.\n");
+		pthread_mutex_destroy(&w->lock);
+		close(w->quit[0]);
+		close(w->quit[1]);
+		close(w->fd);
+		free(w);
+		return NULL;
+	}
+	return w;
+}
+/* Watch an object's OBJ file and everything it loaded.
+ */
+int watch_object(struct objwatch *w, struct objfile *obj, const char *filename)
+{
+	int err;
+
+	if(obj->arena != NULL) {
+		fprintf(stderr, "Error: Cannot watch arena backed object: %s\n",
+			filename);
+		return 1;
+	}
+	pthread_mutex_lock(&w->lock);
+	remove_entries(w, obj, -1);
+	if((err = add_entry(w, obj, filename, WATCH_OBJ)) == 0)
+		add_material_entries(w, obj);
+	pthread_mutex_unlock(&w->lock);
+	return err;
+}
+/* Stop watching an object, must be called before destroying it.
+ */
+void unwatch_object(struct objwatch *w, struct objfile *obj)
+{
+	struct watch_reload *pending = NULL;
+	size_t i;
+
+	pthread_mutex_lock(&w->lock);
+	remove_entries(w, obj, -1);
+	for(i = 0; i < vector_size(w->pending); i++) {
+		if(w->pending[i].obj == obj)
+			free_reload(&w->pending[i]);
+		else
+			vector_push_back(pending, w->pending[i]);
+	}
+	vector_free(w->pending);
+	w->pending = pending;
+	pthread_mutex_unlock(&w->lock);
+}
+/* Apply finished reloads, call from the GL thread between frames.
+ */
+int poll_watch(struct objwatch *w)
+{
+	struct watch_reload *pending;
+	size_t i, count;
+
+	pthread_mutex_lock(&w->lock);
+	pending = w->pending;
+	w->pending = NULL;
+	pthread_mutex_unlock(&w->lock);
+
+	count = vector_size(pending);
+	for(i = 0; i < count; i++) {
+		struct watch_reload *r = &pending[i];
+		switch(r->kind) {
+		case WATCH_OBJ:
+			apply_object(w, r->obj, r->parsed);
+			break;
+		case WATCH_MTL:
+			apply_materials(w, r->obj, r->parsed);
+			break;
+		case WATCH_BMP:
+			apply_texture(r->obj, r->path, r->bmp);
+			break;
+		}
+		printf("Reloaded: %s\n", r->path);
+	}
+	vector_free(pending);
+	return count;
+}
+/* Stop watch thread and free watcher.
+ */
+void destroy_watch(struct objwatch *w)
+{
+	size_t i;
+
+	if(w == NULL)
+		return;
+	if(write(w->quit[1], "q", 1) == 1)
+		pthread_join(w->thread, NULL);
+	close(w->quit[0]);
+	close(w->quit[1]);
+	close(w->fd);
+	for(i = 0; i < vector_size(w->pending); i++)
+		free_reload(&w->pending[i]);
+	vector_free(w->pending);
+	vector_free(w->entries);
+	pthread_mutex_destroy(&w->lock);
+	free(w);
+}
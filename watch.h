@@ -0,0 +1,37 @@
+/**
+ * @file watch.h
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Hot reload of objects when their files change.
+ *
+ * @details Watches the OBJ, MTL and BMP files of loaded objects with
+ * inotify. Changed files are parsed again on a background thread and
+ * swapped into the live object by poll_watch() on the GL thread. Only
+ * the changed part is uploaded again: a material or texture change
+ * leaves the geometry list untouched.
+ */
+
+#ifndef PRS_WATCH_H
+#define PRS_WATCH_H
+
+#include "export.h"
+#include "object.h"
+
+struct objwatch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+PRS_EXPORT struct objwatch *init_watch(void);
+PRS_EXPORT int watch_object(struct objwatch *w, struct objfile *obj,
+	const char *filename);
+PRS_EXPORT void unwatch_object(struct objwatch *w, struct objfile *obj);
+PRS_EXPORT int poll_watch(struct objwatch *w);
+PRS_EXPORT void destroy_watch(struct objwatch *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
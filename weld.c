@@ -0,0 +1,398 @@
+/**
+ * @file weld.c
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Vertex welding and sharing of identical objects.
+ *
+ * @details Positions are welded through a grid of epsilon sized cells,
+ * a vertex only has to be compared with vertices kept in its own and
+ * the 26 neighbouring cells. Normals and texture coordinates are
+ * matched exactly. Arrays are compacted in place, keeping the first
+ * copy of every element in file order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "weld.h"
+#include "arena.h"
+#include "object.h"
+
+#define FNV_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+struct cell {
+	long long x, y, z;
+};
+
+struct entry {
+	uint64_t hash;
+	size_t index;
+};
+
+/* --------------------------- Helper Functions -------------------------- */
+
+/* Mix bytes into an FNV-1a hash.
+ */
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len)
+{
+	const unsigned char *p = (const unsigned char*)data;
+
+	while(len-- > 0) {
+		h ^= *p++;
+		h *= FNV_PRIME;
+	}
+	return h;
+}
+/* Create an empty hash table for count entries, kept at most half full.
+ */
+static int *init_table(size_t count, size_t *mask)
+{
+	size_t size = 16;
+	int *slot;
+
+	while(size < count*2)
+		size <<= 1;
+	if((slot = (int*)malloc(size*sizeof(int))) == NULL)
+		return NULL;
+	memset(slot, 0xff, size*sizeof(int));
+	*mask = size-1;
+	return slot;
+}
+/* Get grid cell holding position.
+ */
+static struct cell get_cell(const struct vec3 *p, double inv)
+{
+	struct cell c;
+	c.x = (long long)floor(p->x*inv);
+	c.y = (long long)floor(p->y*inv);
+	c.z = (long long)floor(p->z*inv);
+	return c;
+}
+/* Find a kept position in cell c within epsilon of p, or -1.
+ */
+static int find_near(const struct vec3 *v, const int *slot, size_t mask,
+	struct cell c, const struct vec3 *p, double inv, float eps2)
+{
+	size_t h = (size_t)hash_bytes(FNV_BASIS, &c, sizeof(c)) & mask;
+
+	for(; slot[h] >= 0; h = (h+1) & mask) {
+		const struct vec3 *r = &v[slot[h]];
+		struct cell rc = get_cell(r, inv);
+		float dx = r->x-p->x, dy = r->y-p->y, dz = r->z-p->z;
+
+		if(rc.x == c.x && rc.y == c.y && rc.z == c.z &&
+				dx*dx + dy*dy + dz*dz <= eps2)
+			return slot[h];
+	}
+	return -1;
+}
+/* Weld positions within eps, map gets old to new index.
+ * Returns new count or (size_t)-1 when out of memory.
+ */
+static size_t weld_positions(struct vec3 *v, size_t n, float eps, int *map)
+{
+	double inv = 1.0/eps;
+	size_t i, mask, count = 0;
+	int *slot;
+
+	if((slot = init_table(n, &mask)) == NULL)
+		return (size_t)-1;
+	for(i = 0; i < n; i++) {
+		struct cell c = get_cell(&v[i], inv);
+		int k, found = -1;
+
+		for(k = 0; k < 27 && found < 0; k++) {
+			struct cell nc;
+			nc.x = c.x + k/9 - 1;
+			nc.y = c.y + k/3%3 - 1;
+			nc.z = c.z + k%3 - 1;
+			found = find_near(v, slot, mask, nc, &v[i], inv, eps*eps);
+		}
+		if(found < 0) {
+			size_t h = (size_t)hash_bytes(FNV_BASIS, &c, sizeof(c)) & mask;
+
+			while(slot[h] >= 0)
+				h = (h+1) & mask;
+			found = (int)count;
+			slot[h] = found;
+			v[count++] = v[i];
+		}
+		map[i] = found;
+	}
+	free(slot);
+	return count;
+}
+/* Drop byte identical elements, map gets old to new index.
+ * Returns new count or (size_t)-1 when out of memory.
+ */
+static size_t dedupe(void *data, size_t n, size_t elem, int *map)
+{
+	unsigned char *base = (unsigned char*)data;
+	size_t i, mask, count = 0;
+	int *slot;
+
+	if((slot = init_table(n, &mask)) == NULL)
+		return (size_t)-1;
+	for(i = 0; i < n; i++) {
+		const unsigned char *p = base + i*elem;
+		size_t h = (size_t)hash_bytes(FNV_BASIS, p, elem) & mask;
+
+		for(; slot[h] >= 0; h = (h+1) & mask)
+			if(memcmp(base + slot[h]*elem, p, elem) == 0)
+				break;
+		if(slot[h] < 0) {
+			memmove(base + count*elem, p, elem);
+			slot[h] = (int)count++;
+		}
+		map[i] = slot[h];
+	}
+	free(slot);
+	return count;
+}
+/* Turn negative zeros positive so equal values have equal bytes.
+ */
+static void fix_zeros(float *p, size_t n)
+{
+	size_t i;
+	for(i = 0; i < n; i++)
+		p[i] += 0.0f;
+}
+/* Remap a one based index, zero and bad indices are left alone.
+ */
+static int remap(int idx, const int *map, size_t n)
+{
+	if(idx < 1 || (size_t)idx > n)
+		return idx;
+	return map[idx-1]+1;
+}
+/* Hash the fields of a face.
+ */
+static uint64_t hash_face(uint64_t h, const struct face *f)
+{
+	int k[8];
+
+	k[0] = f->num;
+	k[1] = f->mat;
+	k[2] = f->face.f1;
+	k[3] = f->face.f2;
+	k[4] = f->face.f3;
+	k[5] = f->tex.f1;
+	k[6] = f->tex.f2;
+	k[7] = f->tex.f3;
+	return hash_bytes(h, k, sizeof(k));
+}
+/* Check if two faces are the same.
+ */
+static int same_face(const struct face *a, const struct face *b)
+{
+	return a->num == b->num && a->mat == b->mat &&
+		a->face.f1 == b->face.f1 && a->face.f2 == b->face.f2 &&
+		a->face.f3 == b->face.f3 && a->tex.f1 == b->tex.f1 &&
+		a->tex.f2 == b->tex.f2 && a->tex.f3 == b->tex.f3;
+}
+/* Hash a material, leaving out its GL texture name.
+ */
+static uint64_t hash_material(uint64_t h, const struct material *m)
+{
+	h = hash_bytes(h, m->name, strlen(m->name));
+	h = hash_bytes(h, &m->alpha, sizeof(float));
+	h = hash_bytes(h, &m->ns, sizeof(float));
+	h = hash_bytes(h, &m->ni, sizeof(float));
+	h = hash_bytes(h, m->dif, sizeof(m->dif));
+	h = hash_bytes(h, m->amb, sizeof(m->amb));
+	h = hash_bytes(h, m->spec, sizeof(m->spec));
+	h = hash_bytes(h, m->map, strlen(m->map));
+	return hash_bytes(h, &m->illum, sizeof(int));
+}
+/* Check if two materials are the same, leaving out GL texture name.
+ */
+static int same_material(const struct material *a, const struct material *b)
+{
+	return strcmp(a->name, b->name) == 0 && strcmp(a->map, b->map) == 0 &&
+		memcmp(&a->alpha, &b->alpha, sizeof(float)) == 0 &&
+		memcmp(&a->ns, &b->ns, sizeof(float)) == 0 &&
+		memcmp(&a->ni, &b->ni, sizeof(float)) == 0 &&
+		memcmp(a->dif, b->dif, sizeof(a->dif)) == 0 &&
+		memcmp(a->amb, b->amb, sizeof(a->amb)) == 0 &&
+		memcmp(a->spec, b->spec, sizeof(a->spec)) == 0 &&
+		a->illum == b->illum;
+}
+/* Objects can share only if freeing one cannot free the other's data.
+ */
+static int can_share(const struct objfile *a, const struct objfile *b)
+{
+	return a->arena == b->arena &&
+		(a->arena == NULL || a->arena->owner == NULL);
+}
+/* Order entries by hash, then by position.
+ */
+static int cmp_entry(const void *a, const void *b)
+{
+	const struct entry *x = (const struct entry*)a;
+	const struct entry *y = (const struct entry*)b;
+
+	if(x->hash != y->hash)
+		return x->hash < y->hash ? -1 : 1;
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/* --------------------------- Weld Functions ---------------------------- */
+
+/* Weld positions closer than epsilon, drop repeated normals and texture
+ * coordinates and remap faces. An epsilon of zero only merges equal
+ * positions. Returns number of elements removed or -1 on error.
+ */
+long weld_object(struct objfile *obj, float epsilon)
+{
+	size_t nv, nvn, nt, i;
+	int *map;
+
+	if(obj->l > 0) {
+		fprintf(stderr, "Error: Cannot weld object after upload.\n");
+		return -1;
+	}
+	map = (int*)malloc((obj->nv + obj->nvn + obj->nt + 1)*sizeof(int));
+	if(!map) {
+		fprintf(stderr, "Error: Cannot weld object, out of memory.\n");
+		return -1;
+	}
+	fix_zeros((float*)obj->vn, obj->nvn*3);
+	fix_zeros((float*)obj->t, obj->nt*2);
+	if(epsilon > 0.0f) {
+		nv = weld_positions(obj->v, obj->nv, epsilon, map);
+	} else {
+		fix_zeros((float*)obj->v, obj->nv*3);
+		nv = dedupe(obj->v, obj->nv, sizeof(struct vec3), map);
+	}
+	nvn = dedupe(obj->vn, obj->nvn, sizeof(struct vec3), map + obj->nv);
+	nt = dedupe(obj->t, obj->nt, sizeof(struct texcoord),
+		map + obj->nv + obj->nvn);
+	if(nv == (size_t)-1 || nvn == (size_t)-1 || nt == (size_t)-1) {
+		/* Arrays may be half compacted, object is not usable. */
+		fprintf(stderr, "Error: Cannot weld object, out of memory.\n");
+		free(map);
+		return -1;
+	}
+
+	for(i = 0; i < obj->nf; i++) {
+		struct face *f = &obj->f[i];
+		const int *vmap = map, *nmap = map + obj->nv;
+		const int *tmap = map + obj->nv + obj->nvn;
+
+		f->face.f1 = remap(f->face.f1, vmap, obj->nv);
+		f->face.f2 = remap(f->face.f2, vmap, obj->nv);
+		f->face.f3 = remap(f->face.f3, vmap, obj->nv);
+		f->tex.f1 = remap(f->tex.f1, tmap, obj->nt);
+		f->tex.f2 = remap(f->tex.f2, tmap, obj->nt);
+		f->tex.f3 = remap(f->tex.f3, tmap, obj->nt);
+		f->num = remap(f->num, nmap, obj->nvn);
+	}
+	free(map);
+
+	i = (obj->nv - nv) + (obj->nvn - nvn) + (obj->nt - nt);
+	obj->nv = nv;
+	obj->nvn = nvn;
+	obj->nt = nt;
+	return (long)i;
+}
+/* Hash the content of an object, GL names are left out.
+ */
+uint64_t hash_object(const struct objfile *obj)
+{
+	uint64_t h = FNV_BASIS;
+	size_t i;
+
+	h = hash_bytes(h, &obj->nv, sizeof(size_t));
+	h = hash_bytes(h, &obj->nvn, sizeof(size_t));
+	h = hash_bytes(h, &obj->nt, sizeof(size_t));
+	h = hash_bytes(h, &obj->nf, sizeof(size_t));
+	h = hash_bytes(h, &obj->nmat, sizeof(size_t));
+	h = hash_bytes(h, &obj->nsub, sizeof(size_t));
+	h = hash_bytes(h, obj->v, obj->nv*sizeof(struct vec3));
+	h = hash_bytes(h, obj->vn, obj->nvn*sizeof(struct vec3));
+	h = hash_bytes(h, obj->t, obj->nt*sizeof(struct texcoord));
+	for(i = 0; i < obj->nf; i++)
+		h = hash_face(h, &obj->f[i]);
+	for(i = 0; i < obj->nmat; i++)
+		h = hash_material(h, &obj->mat[i]);
+	for(i = 0; i < obj->nsub; i++) {
+		h = hash_bytes(h, obj->sub[i].name, strlen(obj->sub[i].name));
+		h = hash_bytes(h, &obj->sub[i].first, sizeof(size_t));
+		h = hash_bytes(h, &obj->sub[i].count, sizeof(size_t));
+	}
+	return h;
+}
+/* Check if two objects hold byte identical geometry and materials.
+ */
+int same_object(const struct objfile *a, const struct objfile *b)
+{
+	size_t i;
+
+	if(a == b)
+		return 1;
+	if(a->nv != b->nv || a->nvn != b->nvn || a->nt != b->nt ||
+			a->nf != b->nf || a->nmat != b->nmat || a->nsub != b->nsub)
+		return 0;
+	if(memcmp(a->v, b->v, a->nv*sizeof(struct vec3)) != 0 ||
+			memcmp(a->vn, b->vn, a->nvn*sizeof(struct vec3)) != 0 ||
+			memcmp(a->t, b->t, a->nt*sizeof(struct texcoord)) != 0)
+		return 0;
+	for(i = 0; i < a->nf; i++)
+		if(!same_face(&a->f[i], &b->f[i]))
+			return 0;
+	for(i = 0; i < a->nmat; i++)
+		if(!same_material(&a->mat[i], &b->mat[i]))
+			return 0;
+	for(i = 0; i < a->nsub; i++)
+		if(strcmp(a->sub[i].name, b->sub[i].name) != 0 ||
+				a->sub[i].first != b->sub[i].first ||
+				a->sub[i].count != b->sub[i].count)
+			return 0;
+	return 1;
+}
+/* Replace identical objects in array by the first copy and destroy the
+ * rest, the kept copy counts its references. Returns number shared.
+ */
+size_t share_objects(struct objfile **objs, size_t count)
+{
+	size_t i, j, k, m, shared = 0;
+	struct entry *e;
+
+	if(count < 2)
+		return 0;
+	if((e = (struct entry*)malloc(count*sizeof(struct entry))) == NULL) {
+		fprintf(stderr, "Error: Cannot share objects, out of memory.\n");
+		return 0;
+	}
+	for(i = 0; i < count; i++) {
+		e[i].hash = hash_object(objs[i]);
+		e[i].index = i;
+	}
+	qsort(e, count, sizeof(struct entry), cmp_entry);
+
+	for(i = 0; i < count; i = j) {
+		for(j = i+1; j < count && e[j].hash == e[i].hash; j++);
+		for(k = i+1; k < j; k++) {
+			struct objfile *obj = objs[e[k].index];
+
+			for(m = i; m < k; m++) {
+				struct objfile *keep = objs[e[m].index];
+
+				if(keep == obj)
+					break;
+				if(can_share(keep, obj) && same_object(keep, obj)) {
+					objs[e[k].index] = keep;
+					keep->refs++;
+					destroy_object(obj);
+					shared++;
+					break;
+				}
+			}
+		}
+	}
+	free(e);
+	return shared;
+}
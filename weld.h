@@ -0,0 +1,37 @@
+/**
+ * @file weld.h
+ * @author Philip R. Simonson
+ * @date 19 October 2026
+ * @brief Vertex welding and sharing of identical objects.
+ *
+ * @details weld_object() merges positions closer than an epsilon using
+ * a spatial hash grid, drops repeated normals and texture coordinates
+ * and remaps the faces, shrinking the arrays in place. Run it after
+ * parse_object() and before upload_object(). share_objects() finds
+ * objects (e.g. animation frames) with identical content and makes
+ * them all point at one reference counted copy.
+ */
+
+#ifndef PRS_WELD_H
+#define PRS_WELD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "export.h"
+#include "object.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+PRS_EXPORT long weld_object(struct objfile *obj, float epsilon);
+PRS_EXPORT uint64_t hash_object(const struct objfile *obj);
+PRS_EXPORT int same_object(const struct objfile *a, const struct objfile *b);
+PRS_EXPORT size_t share_objects(struct objfile **objs, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif